@@ -0,0 +1,72 @@
+#!/bin/sh
+# Arka plan iş kabulü: bellek ve CPU yoğun işleri & ile topluca başlatan bir
+# betiği kuyruk kapalıyken ve açıkken (BG_MAX_JOBS + BG_PSI_MEMORY) çalıştırır,
+# toplam süreyi (makespan) ve iş ağacının en yüksek bellek kullanımını raporlar.
+# Bellek, kabuk ve tüm torunlarının VmRSS toplamı olarak 50 ms'de bir örneklenir.
+# Kullanım: sh bench/admission_bench.sh [kabuk_programı] [iş_sayısı] [iş_başına_MiB]
+
+PROGRAM=${1:-./program}
+JOBS=${2:-16}
+SIZE_MB=${3:-64}
+CORES=$(nproc 2>/dev/null || echo 1)
+SCRIPT=$(mktemp)
+
+trap 'rm -f "$SCRIPT"' EXIT
+
+# Her iş SIZE_MB boyutunda bir dizgiyi bellekte tutarken CPU harcar
+i=0
+while [ "$i" -lt "$JOBS" ]; do
+    echo "awk -v n=$((SIZE_MB * 1024 * 1024)) 'BEGIN { s = \"x\"; while (length(s) < n) s = s s; for (i = 0; i < 5000000; i++) x += i }' &"
+    i=$((i + 1))
+done > "$SCRIPT"
+echo "wait" >> "$SCRIPT"
+
+now() {
+    date +%s.%N
+}
+
+# tree_rss <pid>: sürecin ve tüm torunlarının VmRSS toplamı (KiB)
+tree_rss() {
+    cat /proc/[0-9]*/status 2>/dev/null | awk -v root="$1" '
+        /^Pid:/ { pid = $2 }
+        /^PPid:/ { ppid[pid] = $2 }
+        /^VmRSS:/ { rss[pid] = $2 }
+        END {
+            for (p in rss) {
+                q = p
+                while (q != "" && q != 0 && q != root) q = ppid[q]
+                if (q == root) sum += rss[p]
+            }
+            print sum + 0
+        }'
+}
+
+# running <pid>: süreç var ve henüz zombi değilse başarılı
+running() {
+    state=$(awk '/^State:/ { print $2 }' "/proc/$1/status" 2>/dev/null)
+    [ -n "$state" ] && [ "$state" != Z ]
+}
+
+# run <etiket> [ortam atamaları...]
+run() {
+    label=$1
+    shift
+    peak=0
+    start=$(now)
+    env "$@" "$PROGRAM" "$SCRIPT" > /dev/null &
+    shell=$!
+    while running "$shell"; do
+        rss=$(tree_rss "$shell")
+        [ "$rss" -gt "$peak" ] && peak=$rss
+        sleep 0.05
+    done
+    wait "$shell"
+    end=$(now)
+    awk -v l="$label" -v s="$start" -v e="$end" -v p="$peak" '
+        BEGIN { printf "%-24s %10.2f %14.0f\n", l, e - s, p / 1024 }'
+}
+
+printf '%d iş x %d MiB, %d çekirdek\n' "$JOBS" "$SIZE_MB" "$CORES"
+printf '%-24s %10s %14s\n' "kuyruk" "süre (sn)" "tepe bellek (MiB)"
+run "kapalı"
+run "açık (BG_MAX_JOBS=$CORES)" BG_MAX_JOBS="$CORES" BG_PSI_MEMORY=10
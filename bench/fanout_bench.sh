@@ -0,0 +1,29 @@
+#!/bin/sh
+# Fan-out verimi karşılaştırması: aynı akışı iki tüketiciye dağıtırken
+# osprojectsh '|+' (tee(2)/splice(2) aktarıcısı) ile bash + tee(1) hattını ölçer.
+# Kullanım: sh bench/fanout_bench.sh [kabuk_programı] [MB]
+
+PROGRAM=${1:-./program}
+MB=${2:-2048}
+BYTES=$((MB * 1024 * 1024))
+
+now() {
+    date +%s.%N
+}
+
+report() {
+    awk -v name="$1" -v s="$2" -v e="$3" -v mb="$MB" \
+        'BEGIN { t = e - s; printf "%-22s %10.3f %10.0f\n", name, t, mb / t }'
+}
+
+printf '%-22s %10s %10s\n' "yöntem" "süre (sn)" "MB/sn"
+
+start=$(now)
+"$PROGRAM" -c "head -c $BYTES /dev/zero |+ wc -c |+ wc -c" >/dev/null || exit 1
+report "osprojectsh |+" "$start" "$(now)"
+
+if command -v bash >/dev/null 2>&1; then
+    start=$(now)
+    bash -c "head -c $BYTES /dev/zero | tee >(wc -c >/dev/null) | wc -c" >/dev/null || exit 1
+    report "bash | tee" "$start" "$(now)"
+fi
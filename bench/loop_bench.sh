@@ -0,0 +1,27 @@
+#!/bin/sh
+# Döngü hızı karşılaştırması: iç içe for döngüleri (10^5 iterasyon) ile
+# osprojectsh, bash ve dash için saniyedeki iterasyon sayısını ölçer.
+# Kullanım: sh bench/loop_bench.sh [kabuk_programı]
+
+PROGRAM=${1:-./program}
+D="0 1 2 3 4 5 6 7 8 9"
+ITERATIONS=100000
+SCRIPT="for a in $D; do for b in $D; do for c in $D; do for d in $D; do for e in $D; do
+x=\$a\$b\$c\$d\$e; true
+done; done; done; done; done"
+
+now() {
+    date +%s.%N
+}
+
+printf '%-12s %10s %14s\n' "kabuk" "süre (sn)" "iterasyon/sn"
+for sh in "$PROGRAM" bash dash; do
+    if ! command -v "$sh" >/dev/null 2>&1; then
+        continue
+    fi
+    start=$(now)
+    "$sh" -c "$SCRIPT" || exit 1
+    end=$(now)
+    awk -v sh="$sh" -v s="$start" -v e="$end" -v n="$ITERATIONS" \
+        'BEGIN { t = e - s; printf "%-12s %10.3f %14.0f\n", sh, t, n / t }'
+done
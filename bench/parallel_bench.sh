@@ -0,0 +1,42 @@
+#!/bin/sh
+# Paralel aşama ölçeklenmesi: CPU yoğun bir satır filtresini |*N ile 1..çekirdek
+# sayısı kopyada çalıştırır, süreyi ve tek kopyaya göre hızlanmayı raporlar.
+# Çıktının sırası seri çalıştırmayla md5 karşılaştırılarak doğrulanır.
+# Kullanım: sh bench/parallel_bench.sh [kabuk_programı] [satır_sayısı]
+
+PROGRAM=${1:-./program}
+LINES=${2:-400000}
+CORES=$(nproc 2>/dev/null || echo 1)
+INPUT=$(mktemp)
+FILTER="awk '{ s = 0; for (i = 0; i < 300; i++) s += i * \$1; print s }'"
+
+trap 'rm -f "$INPUT"' EXIT
+seq 1 "$LINES" > "$INPUT"
+
+now() {
+    date +%s.%N
+}
+
+expected=$(sh -c "$FILTER < $INPUT" | md5sum)
+
+printf '%-8s %10s %10s %8s\n' "kopya" "süre (sn)" "hızlanma" "sıra"
+# 1, 2, 4, ... ve çekirdek sayısının kendisi
+counts=
+n=1
+while [ "$n" -lt "$CORES" ]; do
+    counts="$counts $n"
+    n=$((n * 2))
+done
+counts="$counts $CORES"
+
+base=
+for n in $counts; do
+    start=$(now)
+    got=$("$PROGRAM" -c "cat $INPUT |*$n $FILTER | md5sum")
+    end=$(now)
+    t=$(awk -v s="$start" -v e="$end" 'BEGIN { print e - s }')
+    [ -z "$base" ] && base=$t
+    [ "$got" = "$expected" ] && order=ok || order=HATALI
+    awk -v n="$n" -v t="$t" -v b="$base" -v o="$order" \
+        'BEGIN { printf "%-8d %10.3f %9.2fx %8s\n", n, t, b / t, o }'
+done
@@ -9,24 +9,38 @@ Bessem El Huseydi  G221210584
 
 #include "program.h"
 
-#define TOK_DELIM " \t\r\n\a"
-
 
 // Global değişkenler
 char* currentDirectory;
 bg_process *bg_list = NULL;
+int last_status = 0;
+int interactive = 1;
 
 // Yerleşik komutlar ve fonksiyonları
 char *builtin_commands[] = {
     "cd",
     "help",
-    "quit"
+    "quit",
+    "true",
+    "false",
+    ":",
+    "run-graph",
+    "jobs",
+    "wait",
+    "export"
 };
 
 int (*builtin_functions[])(char**) = {
     &shell_cd,
     &shell_help,
-    &shell_quit
+    &shell_quit,
+    &shell_true,
+    &shell_false,
+    &shell_true,
+    &shell_run_graph,
+    &shell_jobs,
+    &shell_wait,
+    &shell_export
 };
 
 int num_builtins() {
@@ -51,15 +65,17 @@ Programın başlangıç işlemlerini gerçekleştiren fonksiyon
 */
 void initialize_shell() {
     int i;
-    for (i = 0; i < 40; i++)
-        printf("%s", "=");
-    printf("\n");
-    print_spaces();
-    printf("%s%s%s\n", "=", KCYN "              OS PROJECT SHELL               ", KWHT "=");
-    print_spaces();
-    for (i = 0; i < 40; i++)
-        printf("%s", "=");
-    printf("\n");
+    if (interactive) {
+        for (i = 0; i < 40; i++)
+            printf("%s", "=");
+        printf("\n");
+        print_spaces();
+        printf("%s%s%s\n", "=", KCYN "              OS PROJECT SHELL               ", KWHT "=");
+        print_spaces();
+        for (i = 0; i < 40; i++)
+            printf("%s", "=");
+        printf("\n");
+    }
 
     // SIGCHLD sinyalini yakalamak için sinyal işleyicisini ayarla
     struct sigaction sa;
@@ -78,9 +94,13 @@ cd komutunu gerçekleştiren fonksiyon
 int shell_cd(char **args) {
     if (args[1] == NULL) {
         fprintf(stderr, "osprojectsh: \"cd\" komutu için argüman bekleniyor\n");
+        last_status = 1;
     } else {
         if (chdir(args[1]) != 0) {
             perror("osprojectsh");
+            last_status = 1;
+        } else {
+            last_status = 0;
         }
     }
     return 1;
@@ -97,6 +117,7 @@ int shell_help(char **args) {
         printf("  %s\n", builtin_commands[i]);
     }
     printf("Diğer programlar için 'man' komutunu kullanarak yardım alabilirsiniz.\n");
+    last_status = 0;
     return 1;
 }
 
@@ -105,102 +126,47 @@ quit komutunu gerçekleştiren fonksiyon
 */
 int shell_quit(char **args) {
     int status;
-    // Arka planda çalışan tüm süreçleri bekle
+    sigset_t old_mask;
+    // Kuyrukta bekleyen işleri başlat, ardından tüm arka plan süreçlerini bekle
+    drain_job_queue();
+    block_sigchld(&old_mask);
     bg_process *curr = bg_list;
     while (curr != NULL) {
-        waitpid(curr->pid, &status, 0);
-        printf("[%d] retval: %d\n", curr->pid, WEXITSTATUS(status));
+        if (waitpid(curr->pid, &status, 0) > 0) {
+            printf("[%d] retval: %d\n", curr->pid, WEXITSTATUS(status));
+        }
         bg_process *temp = curr;
         curr = curr->next;
+        free(temp->command);
         free(temp);
     }
     exit(0);
 }
 
-// Yardımcı fonksiyonlar
-char **split_line(char *line) {
-    int bufsize = 64, position = 0;
-    char **tokens = malloc(bufsize * sizeof(char*));
-    char *token;
-
-    if (!tokens) {
-        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
-        exit(EXIT_FAILURE);
-    }
-
-    token = strtok(line, TOK_DELIM);
-    while (token != NULL) {
-        tokens[position++] = token;
-
-        if (position >= bufsize) {
-            bufsize += 64;
-            tokens = realloc(tokens, bufsize * sizeof(char*));
-            if (!tokens) {
-                fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
-                exit(EXIT_FAILURE);
-            }
-        }
-
-        token = strtok(NULL, TOK_DELIM);
-    }
-    tokens[position] = NULL;
-    return tokens;
+/**
+true ve : komutlarını gerçekleştiren fonksiyon
+*/
+int shell_true(char **args) {
+    last_status = 0;
+    return 1;
 }
 
 /**
- * Komut satırını borulara göre bölen fonksiyon.
- * @param line Komut satırı girişi.
- * @param num_commands Komut sayısını döndürmek için kullanılan çıktı parametresi.
- * @return Komutların dizi dizisi.
- */
-char ***split_commands(char *line, int *num_commands) {
-    int bufsize = 10;
-    int position = 0;
-    char ***commands = malloc(bufsize * sizeof(char**));
-    char *command;
-    
-    if (!commands) {
-        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
-        exit(EXIT_FAILURE);
-    }
-    
-    command = strtok(line, "|");
-    while (command != NULL) {
-        // Her komut için baştaki boşlukları temizle
-        while (*command == ' ') command++;
-        
-        // Komutu tokenlara ayır
-        commands[position++] = split_line(command);
-        
-        if (position >= bufsize) {
-            bufsize += 10;
-            commands = realloc(commands, bufsize * sizeof(char**));
-            if (!commands) {
-                fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
-                exit(EXIT_FAILURE);
-            }
-        }
-        
-        command = strtok(NULL, "|");
-    }
-    commands[position] = NULL;
-    *num_commands = position;
-
-    // Debug: Bölünmüş komutları yazdır
-    for (int i = 0; i < *num_commands; i++) {
-        printf("Split Command[%d]: '%s'\n", i+1, commands[i][0]);
-    }
-
-    return commands;
+false komutunu gerçekleştiren fonksiyon
+*/
+int shell_false(char **args) {
+    last_status = 1;
+    return 1;
 }
 
 /**
  * Boru (pipe) içeren komut satırlarını çalıştıran fonksiyon.
  * @param commands Borulara ayrılmış komutların dizisi.
  * @param num_commands Komut sayısı.
+ * @param parallel Aşamaların paralel işçi sayıları (|*N) veya NULL.
  * @return 1 Her zaman başarılı olarak döner.
  */
-int execute_piped_commands(char ***commands, int num_commands) {
+int execute_piped_commands(char ***commands, int num_commands, int *parallel) {
     int i;
     pid_t pid;
     int in_fd = 0; // İlk komut için standart giriş
@@ -224,6 +190,7 @@ int execute_piped_commands(char ***commands, int num_commands) {
 
         pid = fork();
         if (pid == 0) {
+            inherit_process_substitutions(i);
             // Çocuk süreç
 
             // Giriş yönlendirmesi
@@ -245,21 +212,18 @@ int execute_piped_commands(char ***commands, int num_commands) {
                 close(fd[1]);
             }
 
-            // Debug: Komut ve Argümanları Yazdırma
-            printf("Executing command %d: %s\n", i + 1, commands[i][0]);
-            for (int j = 0; commands[i][j] != NULL; j++) {
-                printf("  args[%d]: %s\n", j, commands[i][j]);
+            // Paralel aşama: girdi parçalara bölünüp filtrenin kopyalarına dağıtılır
+            if (parallel != NULL && parallel[i] != 0) {
+                exit(run_sharded_stage(commands[i], parallel[i]));
             }
 
             // Komutu yürüt
-            if (execvp(commands[i][0], commands[i]) == -1) {
-                perror("execvp");
-                exit(EXIT_FAILURE);
-            }
+            exec_command(commands[i]);
         } else if (pid < 0) {
             // Fork hatası
             perror("fork");
             free(pids);
+            last_status = 1;
             return 1;
         } else {
             // Ebeveyn süreç
@@ -281,33 +245,521 @@ int execute_piped_commands(char ***commands, int num_commands) {
     // Ebeveyn süreç tüm çocuk süreçlerin bitmesini bekler
     for (i = 0; i < num_commands; i++) {
         int status;
-        waitpid(pids[i], &status, 0);
-        // Çıkış kodlarını burada işleyebilirsiniz
+        wait_foreground(pids[i], &status, 0);
+        // Boru hattının çıkış durumu son komutun çıkış durumudur
+        if (i == num_commands - 1) {
+            last_status = exit_status_code(status);
+        }
+    }
+
+    free(pids);
+    return 1;
+}
+
+/**
+ * Boru uçlarının tamamını kapatan yardımcı fonksiyon.
+ */
+void close_pipes(int (*fds)[2], int count) {
+    for (int i = 0; i < count; i++) {
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+}
+
+/**
+ * Borudan len baytı splice(2) ile taşıyan fonksiyon.
+ * @return Taşınan bayt sayısı; hedef kapandıysa len'den küçük olur.
+ */
+size_t splice_all(int in_fd, int out_fd, size_t len) {
+    size_t moved = 0;
+    while (moved < len) {
+        ssize_t n = splice(in_fd, NULL, out_fd, NULL, len - moved, SPLICE_F_MOVE);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        moved += n;
+    }
+    return moved;
+}
+
+/**
+ * Giriş borusunun başındaki len baytı tüketmeden out_fd'ye çoğaltan fonksiyon.
+ * tee(2) hedefte yer kalmadığında kısmi kopya yapabilir; bu durumda giriş
+ * ara boruya çoğaltılır, gönderilmiş kısım /dev/null'a atılıp kalanı taşınır.
+ * @return Başarılıysa 0, tüketici kapandıysa -1.
+ */
+int tee_exact(int in_fd, int out_fd, size_t len, int *scratch, int devnull) {
+    ssize_t n, n_scratch;
+    do {
+        n = tee(in_fd, out_fd, len, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) return -1;
+    if ((size_t)n == len) return 0;
+
+    do {
+        n_scratch = tee(in_fd, scratch[1], len, 0);
+    } while (n_scratch < 0 && errno == EINTR);
+    if (n_scratch != (ssize_t)len) {
+        // Tur boyutu ara borunun kapasitesiyle sınırlı olduğundan beklenmez
+        fprintf(stderr, "osprojectsh: fan-out: ara boru %zu baytı alamadı, tüketici bırakılıyor\n", len);
+        if (n_scratch > 0) splice_all(scratch[0], devnull, n_scratch);
+        return -1;
+    }
+    splice_all(scratch[0], devnull, n);
+    size_t moved = splice_all(scratch[0], out_fd, len - n);
+    if (moved < len - n) {
+        splice_all(scratch[0], devnull, len - n - moved);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Fan-out aktarıcısı: giriş borusundaki veriyi tee(2) ile her tüketicinin
+ * borusuna çoğaltır ve son tüketiciye splice(2) ile taşır; veri kullanıcı
+ * alanına hiç kopyalanmaz. Çağrılar engelleyici olduğundan en yavaş tüketici
+ * doluysa aktarıcı bekler, giriş borusu dolar ve üretici yavaşlar (geri basınç).
+ * Kapanan tüketiciler listeden çıkarılır, diğerleri beslenmeye devam eder.
+ * @param in_fd Üreticiden gelen borunun okuma ucu.
+ * @param out_fds Tüketici borularının yazma uçları.
+ * @param num_out Tüketici sayısı.
+ */
+void relay_fanout(int in_fd, int *out_fds, int num_out) {
+    int scratch[2];
+    int devnull = open("/dev/null", O_WRONLY);
+    int open_count = num_out;
+
+    signal(SIGPIPE, SIG_IGN);
+    if (devnull < 0 || pipe(scratch) == -1) {
+        perror("osprojectsh: fan-out");
+        exit(EXIT_FAILURE);
+    }
+    /*
+     * Ara boru bir turda çoğaltılan veriyi tek seferde alabilmeli. Büyütme
+     * başarısız olursa (ör. pipe-user-pages-soft sınırı) ara boru küçük kalır;
+     * bu durumda tur boyutu onun gerçek kapasitesine indirilir. Baştaki kısmen
+     * okunmuş tampon fazladan bir yuva tutabileceğinden bir sayfa pay bırakılır.
+     */
+    int scratch_size = fcntl(scratch[1], F_SETPIPE_SZ, fcntl(in_fd, F_GETPIPE_SZ));
+    if (scratch_size < 0) {
+        scratch_size = fcntl(scratch[1], F_GETPIPE_SZ);
+    }
+    long page = sysconf(_SC_PAGESIZE);
+    size_t round = FANOUT_PIPE_SIZE;
+    if (scratch_size > 0 && (size_t)scratch_size < round + page) {
+        round = scratch_size > 2 * page ? (size_t)(scratch_size - page) : (size_t)page;
+    }
+
+    while (open_count > 0) {
+        int i, first = -1, last = -1;
+        ssize_t n;
+
+        for (i = 0; i < num_out; i++) {
+            if (out_fds[i] >= 0) {
+                if (first < 0) first = i;
+                last = i;
+            }
+        }
+
+        // Tek tüketici kaldıysa doğrudan taşı, aksi halde ilk tüketiciye çoğalt;
+        // n bu turda tüm tüketicilere gönderilecek bayt sayısını belirler
+        if (first == last) {
+            n = splice(in_fd, NULL, out_fds[last], NULL, FANOUT_PIPE_SIZE, SPLICE_F_MOVE);
+        } else {
+            n = tee(in_fd, out_fds[first], round, 0);
+        }
+        if (n == 0) break; // Üretici kapandı
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EPIPE) {
+                perror("osprojectsh: fan-out");
+                break;
+            }
+            close(out_fds[first]);
+            out_fds[first] = -1;
+            open_count--;
+            continue;
+        }
+        if (first == last) continue;
+
+        for (i = first + 1; i < last; i++) {
+            if (out_fds[i] >= 0 && tee_exact(in_fd, out_fds[i], n, scratch, devnull) < 0) {
+                close(out_fds[i]);
+                out_fds[i] = -1;
+                open_count--;
+            }
+        }
+
+        // Son tüketici veriyi tüketir; kapandıysa kalan kısım atılır
+        size_t moved = splice_all(in_fd, out_fds[last], n);
+        if (moved < (size_t)n) {
+            splice_all(in_fd, devnull, n - moved);
+            close(out_fds[last]);
+            out_fds[last] = -1;
+            open_count--;
+        }
+    }
+}
+
+/**
+ * Fan-out (|+) boru hattını çalıştıran fonksiyon. Üretici hattının çıktısı
+ * ayrı bir aktarıcı süreç tarafından her tüketicinin girişine çoğaltılır.
+ * @param producer Üretici hattının komutları.
+ * @param num_producer Üretici hattındaki komut sayısı.
+ * @param parallel Üretici aşamalarının paralel işçi sayıları veya NULL.
+ * @param consumers Tüketici komutları.
+ * @param num_consumers Tüketici sayısı.
+ * @return 1 Her zaman başarılı olarak döner.
+ */
+int execute_fanout_commands(char ***producer, int num_producer, int *parallel, char ***consumers, int num_consumers) {
+    // fds[0]: üretici -> aktarıcı, fds[i + 1]: aktarıcı -> i. tüketici
+    int num_pipes = num_consumers + 1;
+    int (*fds)[2] = malloc(num_pipes * sizeof(*fds));
+    pid_t *pids = malloc((num_consumers + 2) * sizeof(pid_t));
+    pid_t pid;
+    int i, status;
+
+    if (!fds || !pids) {
+        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i < num_pipes; i++) {
+        if (pipe(fds[i]) == -1) {
+            perror("pipe");
+            close_pipes(fds, i);
+            free(fds);
+            free(pids);
+            last_status = 1;
+            return 1;
+        }
+        fcntl(fds[i][1], F_SETPIPE_SZ, FANOUT_PIPE_SIZE);
+    }
+
+    // Tüketiciler (üretici çocuğu exit ile çıktığından stdout tamponu önce boşaltılır)
+    fflush(stdout);
+    for (i = 0; i < num_consumers; i++) {
+        pid = fork();
+        if (pid == 0) {
+            inherit_process_substitutions(num_producer + i);
+            if (dup2(fds[i + 1][0], STDIN_FILENO) == -1) {
+                perror("dup2");
+                exit(EXIT_FAILURE);
+            }
+            close_pipes(fds, num_pipes);
+            exec_command(consumers[i]);
+        } else if (pid < 0) {
+            perror("fork");
+        }
+        pids[i] = pid;
+    }
+
+    // Aktarıcı
+    pid = fork();
+    if (pid == 0) {
+        int *out_fds = malloc(num_consumers * sizeof(int));
+        if (!out_fds) {
+            exit(EXIT_FAILURE);
+        }
+        close(fds[0][1]);
+        close_process_substitutions();
+        for (i = 0; i < num_consumers; i++) {
+            close(fds[i + 1][0]);
+            out_fds[i] = fds[i + 1][1];
+        }
+        relay_fanout(fds[0][0], out_fds, num_consumers);
+        exit(EXIT_SUCCESS);
+    } else if (pid < 0) {
+        perror("fork");
+    }
+    pids[num_consumers] = pid;
+
+    // Üretici hattı mevcut boru mekanizmasıyla çalıştırılır
+    pid = fork();
+    if (pid == 0) {
+        if (dup2(fds[0][1], STDOUT_FILENO) == -1) {
+            perror("dup2");
+            exit(EXIT_FAILURE);
+        }
+        close_pipes(fds, num_pipes);
+        execute_piped_commands(producer, num_producer, parallel);
+        exit(last_status);
+    } else if (pid < 0) {
+        perror("fork");
+    }
+    pids[num_consumers + 1] = pid;
+
+    // Ebeveyn süreç boru uçlarını kapatır ve tüm süreçleri bekler
+    close_pipes(fds, num_pipes);
+    last_status = 1;
+    for (i = 0; i < num_consumers + 2; i++) {
+        if (pids[i] <= 0) continue;
+        wait_foreground(pids[i], &status, 0);
+        // Çıkış durumu son tüketicinin çıkış durumudur
+        if (i == num_consumers - 1) {
+            last_status = exit_status_code(status);
+        }
     }
 
+    free(fds);
     free(pids);
     return 1;
 }
 
+/**
+ * Tamponun tamamını yazan fonksiyon (kısmi yazmalar ve EINTR için tekrar dener).
+ * @return Başarılıysa 0, hata durumunda -1.
+ */
+int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * Bekleyen girdiden sıradaki parçanın uzunluğunu bulan fonksiyon. Parça en az
+ * chunk_size bayttır ve kayıt ayracıyla biter; girdi bittiyse kalan her şeydir.
+ * @return Parça uzunluğu; henüz tam bir parça yoksa 0.
+ */
+size_t next_chunk_length(str_buf *pending, size_t chunk_size, char delim, int input_eof) {
+    if (pending->len == 0) return 0;
+    if ((size_t)pending->len >= chunk_size) {
+        char *end = memchr(pending->data + chunk_size - 1, delim, pending->len - chunk_size + 1);
+        if (end != NULL) {
+            return end - pending->data + 1;
+        }
+    }
+    return input_eof ? (size_t)pending->len : 0;
+}
+
+/**
+ * Parçayı işleyecek yeni bir filtre kopyası başlatan fonksiyon.
+ */
+void start_shard_job(shard_job *job, char **args, const char *data, size_t len) {
+    int in_pipe[2], out_pipe[2];
+
+    if (pipe2(in_pipe, O_CLOEXEC) == -1 || pipe2(out_pipe, O_CLOEXEC) == -1) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Diğer işlerin boru uçları O_CLOEXEC sayesinde exec ile kapanır
+        signal(SIGPIPE, SIG_DFL);
+        if (dup2(in_pipe[0], STDIN_FILENO) == -1 || dup2(out_pipe[1], STDOUT_FILENO) == -1) {
+            perror("dup2");
+            exit(EXIT_FAILURE);
+        }
+        exec_command(args);
+    } else if (pid < 0) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+
+    close(in_pipe[0]);
+    close(out_pipe[1]);
+    fcntl(in_pipe[1], F_SETFL, O_NONBLOCK);
+    fcntl(out_pipe[0], F_SETFL, O_NONBLOCK);
+
+    job->pid = pid;
+    job->in_fd = in_pipe[1];
+    job->out_fd = out_pipe[0];
+    job->input = malloc(len > 0 ? len : 1);
+    if (!job->input) {
+        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(job->input, data, len);
+    job->input_len = len;
+    job->input_off = 0;
+    job->output.len = 0;
+}
+
+/**
+ * Paralel boru aşamasını (|*N) çalıştıran fonksiyon; boru hattındaki aşamanın
+ * çocuk sürecinde çağrılır. stdin kayıt sınırlarında parçalara bölünür ve her
+ * parça filtrenin yeni bir kopyasına verilir; aynı anda en fazla workers kopya
+ * çalışır. Çıktılar parça sırasıyla stdout'a yazılır: en eski parçanın çıktısı
+ * doğrudan aktarılır, sonrakiler sıraları gelene kadar bellekte bekletilir.
+ * Parça boyutu SHARD_CHUNK (bayt), kayıt ayracı SHARD_DELIM ("nul" ise '\0',
+ * aksi halde satır sonu) kabuk veya ortam değişkenleriyle ayarlanır.
+ * Çıkış durumu filtrenin tek seferlik çalışmasına denk gelecek şekilde birleştirilir
+ * (grep kuralı): 1'den büyük durumla biten ilk kopyanın durumu (hata veya sinyal),
+ * yoksa herhangi bir kopya 0 ile bittiyse 0, aksi halde 1. Boş girdide filtre bir
+ * kez boş girdiyle çalıştırılır.
+ * @param args Filtre komutu.
+ * @param workers Paralel kopya sayısı; -1 ise çevrimiçi çekirdek sayısı.
+ * @return Aşamanın birleştirilmiş çıkış durumu.
+ */
+int run_sharded_stage(char **args, int workers) {
+    size_t chunk_size = SHARD_CHUNK_DEFAULT;
+    char delim = '\n';
+    char *env;
+    int head = 0, active = 0, input_eof = 0, started = 0, status;
+    int any_success = 0, failure = 0;
+    str_buf pending = { NULL, 0, 0 };
+    char buffer[65536];
+
+    if ((env = get_variable("SHARD_CHUNK")) != NULL && atol(env) > 0) {
+        chunk_size = atol(env);
+    }
+    if ((env = get_variable("SHARD_DELIM")) != NULL && strcmp(env, "nul") == 0) {
+        delim = '\0';
+    }
+    if (workers <= 0) {
+        workers = sysconf(_SC_NPROCESSORS_ONLN);
+        if (workers <= 0) workers = 1;
+    }
+
+    // İşler sıralı bir halka tamponda tutulur; head en eski parçadır
+    shard_job *jobs = calloc(workers, sizeof(shard_job));
+    struct pollfd *fds = malloc((2 * workers + 1) * sizeof(struct pollfd));
+    int *owners = malloc((2 * workers + 1) * sizeof(int));
+    if (!jobs || !fds || !owners) {
+        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+        exit(EXIT_FAILURE);
+    }
+    str_buf_append(&pending, "", 0);
+    signal(SIGPIPE, SIG_IGN);
+
+    while (!input_eof || pending.len > 0 || active > 0 || started == 0) {
+        int i, nfds = 0;
+
+        // Pencerede yer varsa hazır parçaları yeni kopyalara dağıt
+        while (active < workers) {
+            size_t len = next_chunk_length(&pending, chunk_size, delim, input_eof);
+            if (len == 0 && !(input_eof && started == 0)) break;
+            start_shard_job(&jobs[(head + active) % workers], args, pending.data, len);
+            started++;
+            memmove(pending.data, pending.data + len, pending.len - len);
+            pending.len -= len;
+            active++;
+        }
+
+        // Girdi yalnızca pencerede yer varken okunur; böylece bellek sınırlı kalır
+        if (!input_eof && active < workers) {
+            fds[nfds].fd = STDIN_FILENO;
+            fds[nfds].events = POLLIN;
+            owners[nfds++] = -1;
+        }
+        for (i = 0; i < active; i++) {
+            int k = (head + i) % workers;
+            if (jobs[k].in_fd >= 0) {
+                fds[nfds].fd = jobs[k].in_fd;
+                fds[nfds].events = POLLOUT;
+                owners[nfds++] = k;
+            }
+            if (jobs[k].out_fd >= 0) {
+                fds[nfds].fd = jobs[k].out_fd;
+                fds[nfds].events = POLLIN;
+                owners[nfds++] = k;
+            }
+        }
+
+        if (nfds > 0 && poll(fds, nfds, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            break;
+        }
+
+        for (i = 0; i < nfds; i++) {
+            if (fds[i].revents == 0) continue;
+            shard_job *job = owners[i] >= 0 ? &jobs[owners[i]] : NULL;
+            ssize_t n;
+
+            if (job == NULL) {
+                n = read(STDIN_FILENO, buffer, sizeof(buffer));
+                if (n > 0) {
+                    str_buf_append(&pending, buffer, n);
+                } else if (n == 0 || errno != EINTR) {
+                    input_eof = 1;
+                }
+            } else if (fds[i].fd == job->in_fd) {
+                n = write(job->in_fd, job->input + job->input_off, job->input_len - job->input_off);
+                if (n > 0) {
+                    job->input_off += n;
+                }
+                // Parça bitti veya kopya girdisini kapattı (EPIPE)
+                if (job->input_off == job->input_len || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+                    close(job->in_fd);
+                    job->in_fd = -1;
+                    free(job->input);
+                    job->input = NULL;
+                }
+            } else {
+                n = read(job->out_fd, buffer, sizeof(buffer));
+                if (n > 0) {
+                    str_buf_append(&job->output, buffer, n);
+                } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    close(job->out_fd);
+                    job->out_fd = -1;
+                }
+            }
+        }
+
+        // En eski parçanın çıktısını yaz; tamamlandıysa pencereyi kaydır
+        while (active > 0) {
+            shard_job *job = &jobs[head];
+            if (job->output.len > 0) {
+                if (write_all(STDOUT_FILENO, job->output.data, job->output.len) < 0) {
+                    // Sonraki aşama kapandı: kalan kopyaları durdur
+                    for (i = 0; i < active; i++) {
+                        kill(jobs[(head + i) % workers].pid, SIGTERM);
+                    }
+                    return 141;
+                }
+                job->output.len = 0;
+            }
+            if (job->in_fd >= 0 || job->out_fd >= 0) break;
+
+            wait_foreground(job->pid, &status, 0);
+            int code = exit_status_code(status);
+            if (code == 0) {
+                any_success = 1;
+            } else if (code > 1 && failure == 0) {
+                failure = code;
+            }
+            free(job->output.data);
+            memset(job, 0, sizeof(shard_job));
+            head = (head + 1) % workers;
+            active--;
+        }
+    }
+
+    free(pending.data);
+    free(jobs);
+    free(fds);
+    free(owners);
+    if (failure != 0) {
+        return failure;
+    }
+    return any_success ? 0 : 1;
+}
+
 int execute_external(char **args) {
     pid_t pid, wpid;
     int status;
 
     pid = fork();
     if (pid == 0) {
+        inherit_process_substitutions(-1);
         // Çocuk süreç: komutu yürüt
-        if (execvp(args[0], args) == -1) {
-            perror("execvp");
-        }
-        exit(EXIT_FAILURE);
+        exec_command(args);
     } else if (pid < 0) {
         // Hata durumu
         perror("fork");
+        last_status = 1;
     } else {
         // Ebeveyn süreç: çocuğun bitmesini bekle
         do {
-            wpid = waitpid(pid, &status, WUNTRACED);
+            wpid = wait_foreground(pid, &status, WUNTRACED);
         } while (!WIFEXITED(status) && !WIFSIGNALED(status));
+        last_status = exit_status_code(status);
     }
 
     return 1;
@@ -322,6 +774,7 @@ int execute_external_with_input_redirection(char **args, char *input_file) {
 
     pid = fork();
     if (pid == 0) {
+        inherit_process_substitutions(-1);
         // Çocuk süreç: giriş dosyasını stdin'e yönlendir
         int fd_in = open(input_file, O_RDONLY);
         if (fd_in < 0) {
@@ -336,18 +789,17 @@ int execute_external_with_input_redirection(char **args, char *input_file) {
         close(fd_in);
 
         // Komutu yürüt
-        if (execvp(args[0], args) == -1) {
-            perror("execvp");
-        }
-        exit(EXIT_FAILURE);
+        exec_command(args);
     } else if (pid < 0) {
         // Hata durumu
         perror("fork");
+        last_status = 1;
     } else {
         // Ebeveyn süreç: çocuğun bitmesini bekle
         do {
-            wpid = waitpid(pid, &status, WUNTRACED);
+            wpid = wait_foreground(pid, &status, WUNTRACED);
         } while (!WIFEXITED(status) && !WIFSIGNALED(status));
+        last_status = exit_status_code(status);
     }
 
     return 1;
@@ -362,6 +814,7 @@ int execute_external_with_output_redirection(char **args, char *output_file) {
 
     pid = fork();
     if (pid == 0) {
+        inherit_process_substitutions(-1);
         // Çocuk süreç: çıkış dosyasını stdout'a yönlendir
         int fd_out = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
         if (fd_out < 0) {
@@ -376,138 +829,288 @@ int execute_external_with_output_redirection(char **args, char *output_file) {
         close(fd_out);
 
         // Komutu yürüt
-        if (execvp(args[0], args) == -1) {
-            perror("execvp");
-        }
-        exit(EXIT_FAILURE);
+        exec_command(args);
     } else if (pid < 0) {
         // Hata durumu
         perror("fork");
+        last_status = 1;
     } else {
         // Ebeveyn süreç: çocuğun bitmesini bekle
         do {
-            wpid = waitpid(pid, &status, WUNTRACED);
+            wpid = wait_foreground(pid, &status, WUNTRACED);
         } while (!WIFEXITED(status) && !WIFSIGNALED(status));
+        last_status = exit_status_code(status);
+    }
+
+    return 1;
+}
+
+/**
+ * Dizgi dizisini (NULL ile biten) kopyalayan fonksiyon.
+ * @param count Kopyalanacak öğe sayısı; -1 ise NULL'a kadar.
+ */
+char **copy_string_array(char **items, int count) {
+    if (count < 0) {
+        for (count = 0; items[count] != NULL; count++);
+    }
+    char **copy = malloc((count + 1) * sizeof(char *));
+    if (!copy) {
+        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < count; i++) {
+        copy[i] = strdup(items[i]);
+    }
+    copy[count] = NULL;
+    return copy;
+}
+
+void free_string_array(char **items) {
+    for (int i = 0; items[i] != NULL; i++) {
+        free(items[i]);
     }
+    free(items);
+}
+
+/**
+ * Kabul denetiminden geçemeyen arka plan komutunu kuyruğa alan fonksiyon.
+ * Süreç yerine koyma sözcükleri açılmamış olarak saklanır; iç komutları iş
+ * kabul edildiğinde, kuyruğa alındığı andaki değişkenler ve konumsal
+ * parametrelerle başlatılır.
+ * @param args Komut argümanları; deferred indisleri ham <(..)/>(..) sözcükleridir.
+ * @param deferred Açılımı ertelenen sözcüklerin indisleri.
+ * @param num_deferred deferred dizisinin uzunluğu.
+ * @param frame Geçerli yürütme çerçevesi.
+ * @param reason Kuyruğa alınma nedeni.
+ * @return 1 Her zaman başarılı olarak döner.
+ */
+int queue_background_command(char **args, int *deferred, int num_deferred, vm_frame *frame, const char *reason) {
+    queued_job *job = malloc(sizeof(queued_job));
+    if (!job) {
+        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+        exit(EXIT_FAILURE);
+    }
+    job->args = copy_string_array(args, -1);
+    // Ortam komut önündeki atamaları da içerir; atamalar geri alınsa da iş aynısını görür
+    job->env = copy_string_array(environ, -1);
+    job->num_deferred = num_deferred;
+    job->deferred = NULL;
+    job->vars = NULL;
+    job->params = NULL;
+    job->num_params = 0;
+
+    if (num_deferred > 0) {
+        shell_var **tail = &job->vars;
+        job->deferred = malloc(num_deferred * sizeof(int));
+        if (!job->deferred) {
+            fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(job->deferred, deferred, num_deferred * sizeof(int));
+        for (shell_var *v = variable_list; v; v = v->next) {
+            shell_var *copy = malloc(sizeof(shell_var));
+            if (!copy) {
+                fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+                exit(EXIT_FAILURE);
+            }
+            copy->name = strdup(v->name);
+            copy->value = strdup(v->value);
+            copy->next = NULL;
+            *tail = copy;
+            tail = &copy->next;
+        }
+        job->num_params = frame->argc;
+        job->params = copy_string_array(frame->argv, frame->argc);
+    }
+    enqueue_job(job);
 
+    printf("[kuyrukta] %s (%s)\n", args[0], reason);
+    last_status = 0;
     return 1;
 }
 
 /**
- * Arka planda komutları çalıştıran fonksiyon
+ * Arka plan işini kabul denetimi yapmadan başlatan fonksiyon.
+ * @param args Komut argümanları dizisi.
+ * @param env Çocuğun ortamı; NULL ise kabuğun geçerli ortamı.
+ * @return 1 Her zaman başarılı olarak döner.
  */
-int execute_external_background(char **args) {
+int start_background_job(char **args, char **env) {
     pid_t pid;
-    int status;
+    sigset_t old_mask;
 
+    // Çocuk listeye eklenmeden biterse işleyici onu bulamazdı; SIGCHLD eklemeden sonra işlenir
+    block_sigchld(&old_mask);
     pid = fork();
     if (pid == 0) {
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
+        inherit_process_substitutions(-1);
+        if (env != NULL) {
+            environ = env;
+        }
         // Çocuk süreç: komutu yürüt
         // Arka plan sürecinde terminali kontrol etmek istemiyorsanız, aşağıdaki satırı ekleyebilirsiniz:
         // setsid();
-        if (execvp(args[0], args) == -1) {
-            perror("execvp");
-        }
-        exit(EXIT_FAILURE);
+        exec_command(args);
     } else if (pid < 0) {
         // Hata durumu
         perror("fork");
+        last_status = 1;
     } else {
         // Ebeveyn süreç: arka plan sürecini listeye ekle
-        bg_process *new_bg = malloc(sizeof(bg_process));
-        if (!new_bg) {
-            fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
-            return 1;
-        }
-        new_bg->pid = pid;
-        new_bg->next = bg_list;
-        bg_list = new_bg;
+        add_background_job(pid, join_args(args), 0);
         // Arka plan sürecinin başlatıldığını bildir
         printf("[%d] retval: 0\n", pid);
+        last_status = 0;
     }
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
 
     return 1;
 }
 
 /**
- * Boru karakteri içerip içermediğini kontrol edip uygun şekilde çalıştıran fonksiyon.
- * @param args Komut argümanları dizisi.
- * @param line Orijinal komut satırı girişi.
- * @return 1 Her zaman başarılı olarak döner.
+ * Süreci arka plan listesine ekleyen fonksiyon. SIGCHLD engellenmişken çağrılır.
+ * @param command jobs çıktısındaki komut satırı (liste sahiplenir).
+ * @param owned Süreci çağıran kendisi bekleyecekse 1; SIGCHLD işleyicisi toplamaz.
  */
-int execute_command(char **args, char *line) {
-    // Boru karakteri içerip içermediğini kontrol et
-    int i;
-    int pipe_found = 0;
-    for (i = 0; args[i] != NULL; i++) {
-        if (strcmp(args[i], "|") == 0) {
-            pipe_found = 1;
-            break;
-        }
+void add_background_job(pid_t pid, char *command, int owned) {
+    bg_process *new_bg = malloc(sizeof(bg_process));
+    if (!new_bg) {
+        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+        free(command);
+        return;
     }
+    new_bg->pid = pid;
+    new_bg->command = command;
+    new_bg->owned = owned;
+    new_bg->next = bg_list;
+    bg_list = new_bg;
+}
 
-    if (pipe_found) {
-        // Boru bulundu, komut satırını borulara göre böl
-        // Orijinal komut satırını yeniden birleştirmek yerine, doğrudan borulara göre böl
-        int num_commands = 0;
-        // strdup ile orijinal line'ı kopyalayın çünkü strtok line'ı değiştirecek
-        char *line_copy = strdup(line);
-        if (!line_copy) {
-            fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
-            return 1;
+/**
+ * Süreci arka plan listesinden çıkaran fonksiyon. SIGCHLD engellenmişken çağrılır.
+ */
+void remove_background_job(pid_t pid) {
+    for (bg_process **current = &bg_list; *current != NULL; current = &(*current)->next) {
+        if ((*current)->pid == pid) {
+            bg_process *temp = *current;
+            *current = temp->next;
+            free(temp->command);
+            free(temp);
+            return;
         }
-        char ***commands = split_commands(line_copy, &num_commands);
+    }
+}
 
-        // Boru içeren komutları çalıştır
-        int status = execute_piped_commands(commands, num_commands);
+/**
+ * Yerleşik komutu yönlendirmeleriyle birlikte kabuk sürecinde çalıştıran fonksiyon.
+ * stdin/stdout komut süresince dosyalara bağlanır, ardından geri yüklenir.
+ * @param index builtin_commands içindeki indeks.
+ * @return Yerleşik komutun dönüş değeri.
+ */
+int execute_builtin_redirected(int index, char **args, char *input_file, char *output_file) {
+    int saved_in = -1, saved_out = -1, fd, result = 1;
 
-        // Belleği temizle
-        for (i = 0; i < num_commands; i++) {
-            free(commands[i]);
+    if (input_file != NULL) {
+        fd = open(input_file, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "Giriş dosyası bulunamadı.\n");
+            last_status = 1;
+            return 1;
+        }
+        // Kopyalar O_CLOEXEC ile tutulur; komutun başlattığı çocuklara geçmez
+        saved_in = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 10);
+        dup2(fd, STDIN_FILENO);
+        close(fd);
+    }
+    if (output_file != NULL) {
+        fd = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            perror("open");
+            last_status = 1;
+        } else {
+            fflush(stdout);
+            saved_out = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 10);
+            dup2(fd, STDOUT_FILENO);
+            close(fd);
         }
-        free(commands);
-        free(line_copy);
+    }
 
-        return status;
+    if (output_file == NULL || saved_out >= 0) {
+        result = (*builtin_functions[index])(args);
     }
 
-    // Boru yok, normal şekilde çalıştır
-    // Arka plan çalıştırma kontrolü
-    int background = 0;
-    for (i = 0; args[i] != NULL; i++) {
-        if (strcmp(args[i], "&") == 0) {
-            background = 1;
-            args[i] = NULL; // '&' karakterini kaldır
-            break;
-        }
+    if (saved_out >= 0) {
+        fflush(stdout);
+        dup2(saved_out, STDOUT_FILENO);
+        close(saved_out);
     }
+    if (saved_in >= 0) {
+        dup2(saved_in, STDIN_FILENO);
+        close(saved_in);
+    }
+    return result;
+}
 
-    // Giriş ve Çıkış yönlendirmesi kontrolü
-    char *input_file = NULL;
-    char *output_file = NULL;
+/**
+ * Çocuk süreçte komutu çalıştıran, geri dönmeyen fonksiyon. Ad bir kabuk
+ * fonksiyonu veya yerleşik komutsa bu çocukta kabuk kodu olarak çalıştırılır ve
+ * çocuk onun çıkış durumuyla sonlanır; aksi halde execvp yapılır. Böylece
+ * fonksiyon ve yerleşik komutlar yönlendirmeli, arka planda veya boru hattı
+ * aşaması olarak da çalışır.
+ */
+void exec_command(char **args) {
+    shell_function *fn = find_function(args[0]);
+    int builtin = -1;
 
-    for (i = 0; args[i] != NULL; i++) {
-        if (strcmp(args[i], "<") == 0) {
-            if (args[i + 1] == NULL) {
-                fprintf(stderr, "Giriş dosyası belirtilmedi.\n");
-                return 1;
-            }
-            input_file = args[i + 1];
-            args[i] = NULL; // args dizisini '<' öncesi ile sınırlamak için
-            i++; // 'GirişDosyası' argümanını atlamak için
-        } else if (strcmp(args[i], ">") == 0) {
-            if (args[i + 1] == NULL) {
-                fprintf(stderr, "Çıkış dosyası belirtilmedi.\n");
-                return 1;
-            }
-            output_file = args[i + 1];
-            args[i] = NULL; // args dizisini '>' öncesi ile sınırlamak için
-            i++; // 'ÇıkışDosyası' argümanını atlamak için
+    for (int j = 0; j < num_builtins() && fn == NULL; j++) {
+        if (strcmp(args[0], builtin_commands[j]) == 0) builtin = j;
+    }
+    if (fn != NULL || builtin >= 0) {
+        // exec olmayacağı için bu komuta devredilmemiş (O_CLOEXEC'i duran) uçlar kapatılır
+        for (int i = 0; i < procsub_count; i++) {
+            int fd = procsub_list[i].fd;
+            if (fd >= 0 && (fcntl(fd, F_GETFD) & FD_CLOEXEC)) close(fd);
+        }
+        procsub_count = 0;
+        interactive = 0;
+        if (fn != NULL) {
+            int argc = 0;
+            while (args[argc] != NULL) argc++;
+            execute_bytecode(fn->chunk, fn->entry, argc, args);
+        } else {
+            (*builtin_functions[builtin])(args);
         }
+        fflush(stdout);
+        exit(last_status);
     }
 
+    execvp(args[0], args);
+    perror("execvp");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ * Yönlendirme ve arka plan bilgisi ayrıştırılmış basit komutu çalıştıran fonksiyon.
+ * @param args Komut argümanları dizisi ('<', '>' ve '&' içermez).
+ * @param input_file Giriş dosyası veya NULL.
+ * @param output_file Çıkış dosyası veya NULL.
+ * @param background Komut arka planda çalıştırılacaksa 1.
+ * @return 1 Her zaman başarılı olarak döner.
+ */
+int execute_simple_command(char **args, char *input_file, char *output_file, int background) {
     if (background) {
-        return execute_external_background(args);
+        return start_background_job(args, NULL);
+    }
+
+    // Yerleşik komutlar kabukta çalışır; yönlendirmeleri de kabukta uygulanır
+    for (int j = 0; j < num_builtins(); j++) {
+        if (strcmp(args[0], builtin_commands[j]) == 0) {
+            if (input_file != NULL || output_file != NULL) {
+                return execute_builtin_redirected(j, args, input_file, output_file);
+            }
+            return (*builtin_functions[j])(args);
+        }
     }
 
     if (input_file != NULL && output_file != NULL) {
@@ -517,6 +1120,7 @@ int execute_command(char **args, char *line) {
 
         pid = fork();
         if (pid == 0) {
+            inherit_process_substitutions(-1);
             // Çocuk süreç
 
             // Giriş yönlendirmesi
@@ -546,18 +1150,17 @@ int execute_command(char **args, char *line) {
             close(fd_out);
 
             // Komutu yürüt
-            if (execvp(args[0], args) == -1) {
-                perror("execvp");
-            }
-            exit(EXIT_FAILURE);
+            exec_command(args);
         } else if (pid < 0) {
             // Hata durumu
             perror("fork");
+            last_status = 1;
         } else {
             // Ebeveyn süreç: çocuğun bitmesini bekle
             do {
-                wpid = waitpid(pid, &status, WUNTRACED);
+                wpid = wait_foreground(pid, &status, WUNTRACED);
             } while (!WIFEXITED(status) && !WIFSIGNALED(status));
+            last_status = exit_status_code(status);
         }
 
         return 1;
@@ -569,13 +1172,6 @@ int execute_command(char **args, char *line) {
         return execute_external_with_output_redirection(args, output_file);
     }
 
-    // Yerleşik komutlar kontrolü
-    for (int j = 0; j < num_builtins(); j++) {
-        if (strcmp(args[0], builtin_commands[j]) == 0) {
-            return (*builtin_functions[j])(args);
-        }
-    }
-
     // Yerleşik olmayan komutları çalıştır
     return execute_external(args);
 }
@@ -591,25 +1187,65 @@ void print_spaces() {
     printf("\n");
 }
 
+/**
+ * SIGCHLD'yi engelleyen fonksiyon. bg_list'i değiştiren veya gezen kod bunu
+ * kullanır; böylece sinyal işleyicisi listeyi aynı anda değiştiremez ve fork ile
+ * listeye ekleme arasında biten çocuk kaybolmaz (bildirim eklemeden sonra gelir).
+ * @param old_mask Önceki maske; sigprocmask(SIG_SETMASK, ...) ile geri yüklenir.
+ */
+void block_sigchld(sigset_t *old_mask) {
+    sigset_t block;
+    sigemptyset(&block);
+    sigaddset(&block, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &block, old_mask);
+}
+
 /**
  * Arka plan süreçlerini yakalayan sinyal işleyicisi
  */
 void handle_sigchld(int sig) {
+    int saved_errno = errno;
+    reap_background_jobs();
+    errno = saved_errno;
+}
+
+/**
+ * bg_list'teki biten süreçleri WNOHANG ile toplayıp bildiren fonksiyon. Sinyal
+ * işleyicisinden veya SIGCHLD engellenmişken çağrılır.
+ */
+void reap_background_jobs() {
     pid_t pid;
     int status;
+    siginfo_t info;
+
+    // Yalnızca arka plan süreçlerini topla; ön plandaki komutların (döngü ve boru
+    // hattı aşamaları dahil) çıkış durumları kendi waitpid çağrılarına kalmalı
+    bg_process **current = &bg_list;
+    while (*current) {
+        if ((*current)->owned) {
+            // Sahibi bekler; yalnızca fork ile devralınmış (çocuğumuz olmayan) kayıt atılır
+            if (waitid(P_PID, (*current)->pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 || errno != ECHILD) {
+                current = &((*current)->next);
+                continue;
+            }
+            pid = -1;
+        } else {
+            pid = waitpid((*current)->pid, &status, WNOHANG);
+            if (pid == 0) {
+                current = &((*current)->next);
+                continue;
+            }
+        }
 
-    // Çocuk süreçlerin sonlanmasını kontrol et
-    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
         // Arka plan sürecini listeden çıkar
-        bg_process **current = &bg_list;
-        while (*current) {
-            if ((*current)->pid == pid) {
-                bg_process *temp = *current;
-                *current = (*current)->next;
-                free(temp);
-                break;
-            }
-            current = &((*current)->next);
+        bg_process *temp = *current;
+        *current = (*current)->next;
+        free(temp->command);
+        free(temp);
+
+        // Alt kabukta devralınan liste ebeveynin süreçlerini içerebilir (ECHILD)
+        if (pid < 0) {
+            continue;
         }
 
         // Exit kodunu al
@@ -620,79 +1256,2489 @@ void handle_sigchld(int sig) {
 
         // Kullanıcıya bildir
         printf("\n[%d] retval: %d\n", pid, exit_code);
-        display_prompt();
+        if (interactive) {
+            display_prompt();
+        }
         fflush(stdout);
     }
 }
 
-int main(int argc, char **argv) {
-    char *line = NULL;
-    char **args;
-    int status;
+/**
+ * waitpid ile alınan durumu kabuk çıkış koduna çeviren fonksiyon.
+ * Sinyalle sonlanan süreçler için 128 + sinyal numarası döner.
+ */
+int exit_status_code(int status) {
+    if (WIFEXITED(status)) {
+        return WEXITSTATUS(status);
+    }
+    if (WIFSIGNALED(status)) {
+        return 128 + WTERMSIG(status);
+    }
+    return 1;
+}
 
-    // currentDirectory için bellek ayırın
-    currentDirectory = malloc(1024 * sizeof(char));
-    if (currentDirectory == NULL) {
+/**
+ * Ön plandaki çocuğu bekleyen fonksiyon. Kuyrukta arka plan işi varsa bekleme
+ * SIGCHLD ile ya da en geç 100 ms'de bir uyanır; komut çalışırken yer açılırsa
+ * kuyruktaki işler komutun bitmesi beklenmeden başlatılır.
+ * @param pid Beklenen çocuk.
+ * @param status Çıkış durumunun yazılacağı yer.
+ * @param options waitpid seçenekleri.
+ * @return waitpid'in dönüş değeri.
+ */
+pid_t wait_foreground(pid_t pid, int *status, int options) {
+    struct timespec delay = { 0, 100 * 1000000L };
+    pid_t wpid;
+
+    for (;;) {
+        if (job_queue == NULL) {
+            wpid = waitpid(pid, status, options);
+        } else if ((wpid = waitpid(pid, status, options | WNOHANG)) == 0) {
+            admit_queued_jobs();
+            // Biten her arka plan işi SIGCHLD ile uykuyu erken keser
+            nanosleep(&delay, NULL);
+            continue;
+        }
+        if (wpid == -1 && errno == EINTR) continue;
+        return wpid;
+    }
+}
+
+// ===========================================================================
+// Betik Derleyici ve Sanal Makine
+// ===========================================================================
+
+shell_function *function_list = NULL;
+
+// Operatör tokenlarının hata mesajlarında görünen adları
+char *token_names[] = {
+    "sözcük", "satır sonu", ";", "&", "&&", "||", "|", "|+", "|*", "<", ">", "(", ")", "dosya sonu"
+};
+
+/**
+ * Betik metnini sözcük birimlerine (token) ayıran fonksiyon.
+ * Sözcükler ham halleriyle (tırnaklar dahil) arena belleğine kopyalanır;
+ * tırnak kaldırma ve değişken açılımı çalışma zamanında yapılır.
+ * @param src Betik metni.
+ * @param arena Sözcüklerin kopyalanacağı bellek (en az 2 * strlen(src) + 1 bayt).
+ * @param num_tokens Token sayısını döndürmek için çıktı parametresi.
+ * @return Token dizisi; kapanmamış tırnak varsa NULL döner ve *num_tokens = -1 olur.
+ */
+token *lex_script(const char *src, char *arena, int *num_tokens) {
+    int bufsize = 64, position = 0;
+    token *tokens = malloc(bufsize * sizeof(token));
+    const char *p = src;
+    char *out = arena;
+
+    if (!tokens) {
         fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
         exit(EXIT_FAILURE);
     }
 
-    // Kabuk başlatma
-    initialize_shell();
+    while (1) {
+        if (position >= bufsize) {
+            bufsize += 64;
+            tokens = realloc(tokens, bufsize * sizeof(token));
+            if (!tokens) {
+                fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+                exit(EXIT_FAILURE);
+            }
+        }
 
-    // Ana döngü
-    do {
-        display_prompt();
+        // Boşlukları ve satır devamlarını atla
+        while (*p == ' ' || *p == '\t' || *p == '\r' || (*p == '\\' && p[1] == '\n')) {
+            p += (*p == '\\') ? 2 : 1;
+        }
+        // Yorumlar satır sonuna kadar sürer
+        if (*p == '#') {
+            while (*p && *p != '\n') p++;
+        }
 
-        // Kullanıcı girdisini oku
-        ssize_t bufsize = 0;
-        if (getline(&line, &bufsize, stdin) == -1) {
-            if (feof(stdin)) {
-                // Ctrl+D ile çıkış
-                printf("\n");
-                break;
-            } else {
-                perror("osprojectsh: getline");
+        token *t = &tokens[position++];
+        t->text = NULL;
+        t->quoted = 0;
+
+        if (*p == '\0') {
+            t->type = TK_EOF;
+            break;
+        } else if (*p == '\n') {
+            t->type = TK_NEWLINE;
+            p++;
+        } else if (*p == ';') {
+            t->type = TK_SEMI;
+            p++;
+        } else if (*p == '&') {
+            t->type = (p[1] == '&') ? TK_AND_IF : TK_AMP;
+            p += (p[1] == '&') ? 2 : 1;
+        } else if (*p == '|') {
+            if (p[1] == '|') {
+                t->type = TK_OR_IF;
+            } else if (p[1] == '+') {
+                t->type = TK_FANOUT;
+            } else if (p[1] == '*') {
+                // İşçi sayısı operatöre bitişik yazılır: |*4
+                t->type = TK_PARALLEL;
+                t->text = out;
+                for (p += 2; isdigit((unsigned char)*p); p++) *out++ = *p;
+                *out++ = '\0';
                 continue;
+            } else {
+                t->type = TK_PIPE;
+            }
+            p += (p[1] == '|' || p[1] == '+') ? 2 : 1;
+        } else if ((*p == '<' || *p == '>') && p[1] == '(') {
+            // Süreç yerine koyma: <(komut) / >(komut) eşleşen ')' dahil tek sözcüktür
+            int depth = 0;
+            t->type = TK_WORD;
+            t->text = out;
+            t->quoted = 1;
+            *out++ = *p++;
+            do {
+                if (*p == '\0') goto incomplete;
+                if (*p == '\'' || *p == '"') {
+                    char quote = *p;
+                    *out++ = *p++;
+                    while (*p && *p != quote) {
+                        if (quote == '"' && *p == '\\' && p[1] != '\0') *out++ = *p++;
+                        *out++ = *p++;
+                    }
+                    if (*p == '\0') goto incomplete;
+                } else if (*p == '\\' && p[1] != '\0') {
+                    *out++ = *p++;
+                } else if (*p == '(') {
+                    depth++;
+                } else if (*p == ')') {
+                    depth--;
+                }
+                *out++ = *p++;
+            } while (depth > 0);
+            *out++ = '\0';
+        } else if (*p == '<') {
+            t->type = TK_LESS;
+            p++;
+        } else if (*p == '>') {
+            t->type = TK_GREAT;
+            p++;
+        } else if (*p == '(') {
+            t->type = TK_LPAREN;
+            p++;
+        } else if (*p == ')') {
+            t->type = TK_RPAREN;
+            p++;
+        } else {
+            // Sözcük: tırnaksız bir ayraç görülene kadar devam eder
+            t->type = TK_WORD;
+            t->text = out;
+            while (*p && strchr(" \t\r\n;&|<>()", *p) == NULL) {
+                if (*p == '\'') {
+                    t->quoted = 1;
+                    *out++ = *p++;
+                    while (*p && *p != '\'') *out++ = *p++;
+                    if (*p == '\0') goto incomplete;
+                    *out++ = *p++;
+                } else if (*p == '"') {
+                    t->quoted = 1;
+                    *out++ = *p++;
+                    while (*p && *p != '"') {
+                        if (*p == '\\' && p[1] != '\0') *out++ = *p++;
+                        *out++ = *p++;
+                    }
+                    if (*p == '\0') goto incomplete;
+                    *out++ = *p++;
+                } else if (*p == '\\') {
+                    t->quoted = 1;
+                    if (p[1] == '\0') goto incomplete;
+                    if (p[1] == '\n') {
+                        p += 2;
+                        continue;
+                    }
+                    *out++ = *p++;
+                    *out++ = *p++;
+                } else if (*p == '$' && p[1] == '{') {
+                    while (*p && *p != '}') *out++ = *p++;
+                    if (*p == '\0') goto incomplete;
+                    *out++ = *p++;
+                } else {
+                    *out++ = *p++;
+                }
             }
+            *out++ = '\0';
         }
+    }
 
-        /*
-         * Burada gelen satırı noktalı virgüle göre bölüyoruz.
-         * Her parça (command_part), normalde tek başına yazılan
-         * bir komut satırı gibi ele alınacak.
-         */
-        char *saveptr; 
-        char *command_part = strtok_r(line, ";", &saveptr);
+    *num_tokens = position;
+    return tokens;
 
-        // Bir satırda birden fazla komut (noktalı virgüllerle ayrılmış) olabilir
-        while (command_part != NULL) {
-            // Önde gelen boşlukları temizleyelim
-            while (*command_part == ' ' || *command_part == '\t') {
-                command_part++;
-            }
+incomplete:
+    free(tokens);
+    *num_tokens = -1;
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Ayrıştırıcı (özyinelemeli iniş)
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    token *tokens;
+    int pos;
+    int incomplete;     // Girdi bir yapının ortasında bitti
+    int error;          // Sözdizimi hatası bulundu
+} parser;
+
+ast_node *parse_list(parser *p);
+ast_node *parse_command(parser *p);
+
+token *peek_token(parser *p) {
+    return &p->tokens[p->pos];
+}
+
+int is_keyword(token *t, const char *keyword) {
+    return t->type == TK_WORD && !t->quoted && strcmp(t->text, keyword) == 0;
+}
+
+int is_name(const char *s) {
+    if (!isalpha((unsigned char)*s) && *s != '_') return 0;
+    for (s++; *s; s++) {
+        if (!isalnum((unsigned char)*s) && *s != '_') return 0;
+    }
+    return 1;
+}
+
+void skip_newlines(parser *p) {
+    while (peek_token(p)->type == TK_NEWLINE) p->pos++;
+}
+
+void syntax_error(parser *p) {
+    token *t = peek_token(p);
+    if (t->type == TK_EOF) {
+        // Etkileşimli modda devam satırı istenir
+        p->incomplete = 1;
+    } else if (!p->error) {
+        fprintf(stderr, "osprojectsh: sözdizimi hatası: beklenmeyen '%s'\n",
+                t->type == TK_WORD ? t->text : token_names[t->type]);
+    }
+    p->error = 1;
+}
+
+int expect_keyword(parser *p, const char *keyword) {
+    skip_newlines(p);
+    if (is_keyword(peek_token(p), keyword)) {
+        p->pos++;
+        return 1;
+    }
+    syntax_error(p);
+    return 0;
+}
+
+/**
+ * Listeyi sonlandıran token olup olmadığını kontrol eden fonksiyon.
+ */
+int is_list_end(token *t) {
+    return t->type == TK_EOF || t->type == TK_RPAREN ||
+           is_keyword(t, "then") || is_keyword(t, "elif") || is_keyword(t, "else") ||
+           is_keyword(t, "fi") || is_keyword(t, "do") || is_keyword(t, "done") ||
+           is_keyword(t, "}");
+}
+
+ast_node *new_node(node_type type) {
+    ast_node *node = calloc(1, sizeof(ast_node));
+    if (!node) {
+        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+        exit(EXIT_FAILURE);
+    }
+    node->type = type;
+    return node;
+}
+
+ast_node *new_pair(node_type type, ast_node *left, ast_node *right) {
+    ast_node *node = new_node(type);
+    node->left = left;
+    node->right = right;
+    return node;
+}
+
+void add_word(ast_node *node, char *word) {
+    // words dizisi 8'in katları halinde büyütülür, NULL için yer bırakılır
+    if (node->num_words % 8 == 0) {
+        node->words = realloc(node->words, (node->num_words + 9) * sizeof(char*));
+        if (!node->words) {
+            fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    node->words[node->num_words++] = word;
+    node->words[node->num_words] = NULL;
+}
 
-            // Komut satırını token'lara ayır
-            args = split_line(command_part);
+/**
+ * Sözdizimi ağacını serbest bırakan fonksiyon. Sözcük metinleri arenaya aittir.
+ */
+void free_ast(ast_node *node) {
+    if (node == NULL) return;
+    free_ast(node->left);
+    free_ast(node->right);
+    free_ast(node->extra);
+    free_ast(node->next);
+    free(node->words);
+    free(node);
+}
 
-            // Eğer gerçekten bir komut varsa (args[0] boş değilse) çalıştır
-            if (args[0] != NULL) {
-                status = execute_command(args, command_part);
+/**
+ * Basit komutu (sözcükler ve yönlendirmeler) ayrıştıran fonksiyon.
+ */
+ast_node *parse_simple(parser *p) {
+    ast_node *node = new_node(N_SIMPLE);
+
+    while (1) {
+        token *t = peek_token(p);
+        if (t->type == TK_WORD) {
+            add_word(node, t->text);
+            p->pos++;
+        } else if (t->type == TK_LESS || t->type == TK_GREAT) {
+            p->pos++;
+            if (peek_token(p)->type != TK_WORD) {
+                syntax_error(p);
+                free_ast(node);
+                return NULL;
             }
+            if (t->type == TK_LESS) {
+                node->input_file = peek_token(p)->text;
+            } else {
+                node->output_file = peek_token(p)->text;
+            }
+            p->pos++;
+        } else {
+            break;
+        }
+    }
+
+    if (node->num_words == 0) {
+        syntax_error(p);
+        free_ast(node);
+        return NULL;
+    }
+    return node;
+}
+
+/**
+ * Zorunlu (boş olamayan) bir komut listesini ayrıştıran fonksiyon.
+ */
+ast_node *parse_required_list(parser *p) {
+    ast_node *list = parse_list(p);
+    if (list == NULL && !p->error) {
+        syntax_error(p);
+    }
+    return list;
+}
+
+/**
+ * if/elif yapısını ayrıştıran fonksiyon. elif dalları iç içe N_IF düğümleri
+ * olarak tutulur ve ortak 'fi' en içteki çağrıda tüketilir.
+ */
+ast_node *parse_if(parser *p) {
+    ast_node *node = new_node(N_IF);
+    p->pos++; // 'if' veya 'elif'
+
+    if ((node->left = parse_required_list(p)) == NULL ||
+        !expect_keyword(p, "then") ||
+        (node->right = parse_required_list(p)) == NULL) {
+        free_ast(node);
+        return NULL;
+    }
+
+    token *t = peek_token(p);
+    if (is_keyword(t, "elif")) {
+        if ((node->extra = parse_if(p)) == NULL) {
+            free_ast(node);
+            return NULL;
+        }
+        return node;
+    }
+    if (is_keyword(t, "else")) {
+        p->pos++;
+        if ((node->extra = parse_required_list(p)) == NULL) {
+            free_ast(node);
+            return NULL;
+        }
+    }
+    if (!expect_keyword(p, "fi")) {
+        free_ast(node);
+        return NULL;
+    }
+    return node;
+}
 
-            free(args);
+/**
+ * while/until döngüsünü ayrıştıran fonksiyon.
+ */
+ast_node *parse_while(parser *p) {
+    ast_node *node = new_node(is_keyword(peek_token(p), "while") ? N_WHILE : N_UNTIL);
+    p->pos++;
+
+    if ((node->left = parse_required_list(p)) == NULL ||
+        !expect_keyword(p, "do") ||
+        (node->right = parse_required_list(p)) == NULL ||
+        !expect_keyword(p, "done")) {
+        free_ast(node);
+        return NULL;
+    }
+    return node;
+}
 
-            // Sonraki komut için ilerle
-            command_part = strtok_r(NULL, ";", &saveptr);
+/**
+ * for döngüsünü ayrıştıran fonksiyon. 'in' verilmezse "$@" üzerinde döner.
+ */
+ast_node *parse_for(parser *p) {
+    ast_node *node = new_node(N_FOR);
+    p->pos++; // 'for'
+
+    token *t = peek_token(p);
+    if (t->type != TK_WORD || t->quoted || !is_name(t->text)) {
+        syntax_error(p);
+        free_ast(node);
+        return NULL;
+    }
+    add_word(node, t->text);
+    p->pos++;
+
+    skip_newlines(p);
+    if (is_keyword(peek_token(p), "in")) {
+        p->pos++;
+        while (peek_token(p)->type == TK_WORD) {
+            add_word(node, peek_token(p)->text);
+            p->pos++;
         }
+    } else {
+        add_word(node, "\"$@\"");
+    }
+    if (peek_token(p)->type == TK_SEMI) {
+        p->pos++;
+    }
 
-    } while (status);
+    if (!expect_keyword(p, "do") ||
+        (node->right = parse_required_list(p)) == NULL ||
+        !expect_keyword(p, "done")) {
+        free_ast(node);
+        return NULL;
+    }
+    return node;
+}
 
-    // Belleği serbest bırak
-    free(line);
-    free(currentDirectory);
+/**
+ * { liste } grubunu ayrıştıran fonksiyon. Grup ayrı bir düğüm oluşturmaz.
+ */
+ast_node *parse_group(parser *p) {
+    p->pos++; // '{'
+    ast_node *body = parse_required_list(p);
+    if (body == NULL || !expect_keyword(p, "}")) {
+        free_ast(body);
+        return NULL;
+    }
+    return body;
+}
 
-    return EXIT_SUCCESS;
+/**
+ * ad() komut biçimindeki fonksiyon tanımını ayrıştıran fonksiyon.
+ */
+ast_node *parse_funcdef(parser *p) {
+    token *t = peek_token(p);
+    if (t->quoted || !is_name(t->text) || p->tokens[p->pos + 2].type != TK_RPAREN) {
+        p->pos++;
+        syntax_error(p);
+        return NULL;
+    }
+    ast_node *node = new_node(N_FUNC);
+    add_word(node, t->text);
+    p->pos += 3;
+
+    skip_newlines(p);
+    if ((node->right = parse_command(p)) == NULL) {
+        free_ast(node);
+        return NULL;
+    }
+    return node;
+}
+
+ast_node *parse_command(parser *p) {
+    token *t = peek_token(p);
+    if (t->type == TK_WORD && !t->quoted) {
+        if (is_keyword(t, "if")) return parse_if(p);
+        if (is_keyword(t, "while") || is_keyword(t, "until")) return parse_while(p);
+        if (is_keyword(t, "for")) return parse_for(p);
+        if (is_keyword(t, "{")) return parse_group(p);
+        if (p->tokens[p->pos + 1].type == TK_LPAREN) return parse_funcdef(p);
+    }
+    return parse_simple(p);
+}
+
+/**
+ * [!] komut [| komut]... [|+ komut]... biçimindeki boru hattını ayrıştıran
+ * fonksiyon. İlk '|+' ile hat fan-out'a dönüşür; sonraki komutlar tüketicidir.
+ * '|*N' ile bağlanan aşama N kopya halinde paralel çalıştırılır.
+ */
+ast_node *parse_pipeline(parser *p) {
+    int negate = 0;
+    if (is_keyword(peek_token(p), "!")) {
+        negate = 1;
+        p->pos++;
+    }
+
+    ast_node *node = parse_command(p);
+    if (node == NULL) return NULL;
+
+    token_type type = peek_token(p)->type;
+    if (type == TK_PIPE || type == TK_FANOUT || type == TK_PARALLEL) {
+        ast_node *pipeline = new_node(N_PIPE);
+        ast_node *last = node;
+        ast_node **link;
+        pipeline->left = node;
+        while (1) {
+            // Aşamalar execute_piped_commands ile çalıştırıldığından yalnızca
+            // yönlendirmesiz basit komutlar kabul edilir
+            if (last->type != N_SIMPLE || last->input_file || last->output_file) {
+                fprintf(stderr, "osprojectsh: boru hattında yalnızca yönlendirmesiz basit komutlar destekleniyor\n");
+                p->error = 1;
+                free_ast(pipeline);
+                return NULL;
+            }
+            token *t = peek_token(p);
+            type = t->type;
+            if (type == TK_FANOUT && pipeline->type == N_PIPE) {
+                pipeline->type = N_FANOUT;
+                link = &pipeline->right;
+            } else if ((type == TK_PIPE || type == TK_PARALLEL) && pipeline->type == N_FANOUT) {
+                fprintf(stderr, "osprojectsh: '|+' tüketicilerinden sonra '%s' kullanılamaz\n", token_names[type]);
+                p->error = 1;
+                free_ast(pipeline);
+                return NULL;
+            } else if (type == TK_PIPE || type == TK_FANOUT || type == TK_PARALLEL) {
+                link = &last->next;
+            } else {
+                break;
+            }
+            p->pos++;
+            skip_newlines(p);
+            if ((*link = parse_command(p)) == NULL) {
+                free_ast(pipeline);
+                return NULL;
+            }
+            last = *link;
+            if (type == TK_PARALLEL) {
+                last->parallel = (t->text[0] != '\0' && atoi(t->text) > 0) ? atoi(t->text) : -1;
+            }
+        }
+        node = pipeline;
+    }
+
+    if (negate) {
+        node = new_pair(N_NOT, node, NULL);
+    }
+    return node;
+}
+
+/**
+ * && ve || ile bağlanmış boru hatlarını ayrıştıran fonksiyon.
+ */
+ast_node *parse_and_or(parser *p) {
+    ast_node *node = parse_pipeline(p);
+    while (node != NULL && (peek_token(p)->type == TK_AND_IF || peek_token(p)->type == TK_OR_IF)) {
+        node_type type = (peek_token(p)->type == TK_AND_IF) ? N_AND : N_OR;
+        p->pos++;
+        skip_newlines(p);
+        ast_node *right = parse_pipeline(p);
+        if (right == NULL) {
+            free_ast(node);
+            return NULL;
+        }
+        node = new_pair(type, node, right);
+    }
+    return node;
 }
 
+/**
+ * ;, & veya satır sonuyla ayrılmış komut listesini ayrıştıran fonksiyon.
+ * Liste sonlandırıcı bir anahtar sözcükte (fi, done, ...) durur.
+ */
+ast_node *parse_list(parser *p) {
+    ast_node *list = NULL;
+
+    while (1) {
+        skip_newlines(p);
+        if (is_list_end(peek_token(p))) break;
+
+        ast_node *node = parse_and_or(p);
+        if (node == NULL) {
+            free_ast(list);
+            return NULL;
+        }
+
+        token *t = peek_token(p);
+        if (t->type == TK_AMP) {
+            if (node->type != N_SIMPLE) {
+                fprintf(stderr, "osprojectsh: '&' yalnızca basit komutlar için destekleniyor\n");
+                p->error = 1;
+                free_ast(node);
+                free_ast(list);
+                return NULL;
+            }
+            node->background = 1;
+            p->pos++;
+        } else if (t->type == TK_SEMI || t->type == TK_NEWLINE) {
+            p->pos++;
+        } else if (!is_list_end(t)) {
+            syntax_error(p);
+            free_ast(node);
+            free_ast(list);
+            return NULL;
+        }
 
+        list = list ? new_pair(N_SEQ, list, node) : node;
+    }
+    return list;
+}
+
+/**
+ * Token dizisinin tamamını ayrıştıran fonksiyon.
+ * @param result COMPILE_OK, COMPILE_INCOMPLETE veya COMPILE_ERROR döndürür.
+ * @return Sözdizimi ağacı (boş girdi için NULL).
+ */
+ast_node *parse_script(token *tokens, int *result) {
+    parser p = { tokens, 0, 0, 0 };
+    ast_node *root = parse_list(&p);
+
+    if (!p.error && peek_token(&p)->type != TK_EOF) {
+        // Eşi olmayan fi, done, ) gibi tokenlar
+        syntax_error(&p);
+    }
+    if (p.error) {
+        free_ast(root);
+        *result = p.incomplete ? COMPILE_INCOMPLETE : COMPILE_ERROR;
+        return NULL;
+    }
+    *result = COMPILE_OK;
+    return root;
+}
+
+// ---------------------------------------------------------------------------
+// Bayt kodu derleyici
+// ---------------------------------------------------------------------------
+
+// break/continue hedeflerini tutan döngü bağlamı
+typedef struct loop_ctx {
+    int continue_pc;
+    int *breaks;                // Döngü sonuna yamanacak atlama komutları
+    int num_breaks;
+    struct loop_ctx *outer;
+} loop_ctx;
+
+typedef struct {
+    bytecode *bc;
+    loop_ctx *loop;
+    int error;
+} compiler;
+
+int emit(bytecode *bc, opcode op, int a, int b, int c) {
+    if (bc->code_len >= bc->code_cap) {
+        bc->code_cap += 64;
+        bc->code = realloc(bc->code, bc->code_cap * sizeof(instruction));
+        if (!bc->code) {
+            fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    instruction *in = &bc->code[bc->code_len];
+    in->op = op;
+    in->a = a;
+    in->b = b;
+    in->c = c;
+    return bc->code_len++;
+}
+
+int add_cmd(bytecode *bc, ast_node *node) {
+    if (bc->num_cmds >= bc->cmds_cap) {
+        bc->cmds_cap += 16;
+        bc->cmds = realloc(bc->cmds, bc->cmds_cap * sizeof(compiled_cmd));
+        if (!bc->cmds) {
+            fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    compiled_cmd *cmd = &bc->cmds[bc->num_cmds];
+    cmd->num_words = node->num_words;
+    cmd->words = malloc((node->num_words + 1) * sizeof(char*));
+    if (!cmd->words) {
+        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(cmd->words, node->words, (node->num_words + 1) * sizeof(char*));
+    cmd->input_file = node->input_file;
+    cmd->output_file = node->output_file;
+    cmd->background = node->background;
+    cmd->parallel = node->parallel;
+    return bc->num_cmds++;
+}
+
+/**
+ * break [n] ve continue [n] komutlarını atlamalara derleyen fonksiyon.
+ */
+void compile_loop_jump(compiler *c, ast_node *node, int is_break) {
+    int level = node->words[1] ? atoi(node->words[1]) : 1;
+    loop_ctx *loop = c->loop;
+
+    while (loop != NULL && --level > 0 && loop->outer != NULL) {
+        loop = loop->outer;
+    }
+    if (loop == NULL || level < 0) {
+        fprintf(stderr, "osprojectsh: %s: yalnızca döngü içinde anlamlı\n", node->words[0]);
+        c->error = 1;
+        return;
+    }
+
+    if (is_break) {
+        emit(c->bc, OP_STATUS, 0, 0, 0);
+        loop->breaks = realloc(loop->breaks, (loop->num_breaks + 1) * sizeof(int));
+        loop->breaks[loop->num_breaks++] = emit(c->bc, OP_JMP, -1, 0, 0);
+    } else {
+        emit(c->bc, OP_JMP, loop->continue_pc, 0, 0);
+    }
+}
+
+void compile_node(compiler *c, ast_node *node);
+
+/**
+ * Döngü gövdesini derleyip break atlamalarını döngü sonuna yamayan fonksiyon.
+ */
+void compile_loop_body(compiler *c, ast_node *body, int continue_pc, int *end_pc) {
+    loop_ctx loop = { continue_pc, NULL, 0, c->loop };
+    c->loop = &loop;
+    compile_node(c, body);
+    emit(c->bc, OP_JMP, continue_pc, 0, 0);
+    c->loop = loop.outer;
+
+    *end_pc = c->bc->code_len;
+    for (int i = 0; i < loop.num_breaks; i++) {
+        c->bc->code[loop.breaks[i]].a = *end_pc;
+    }
+    free(loop.breaks);
+}
+
+void compile_node(compiler *c, ast_node *node) {
+    bytecode *bc = c->bc;
+    int jump, end, first, count;
+    ast_node *stage;
+
+    if (node == NULL || c->error) return;
+
+    switch (node->type) {
+    case N_SIMPLE:
+        if (strcmp(node->words[0], "break") == 0) {
+            compile_loop_jump(c, node, 1);
+        } else if (strcmp(node->words[0], "continue") == 0) {
+            compile_loop_jump(c, node, 0);
+        } else if (strcmp(node->words[0], "return") == 0) {
+            emit(bc, OP_RET, add_cmd(bc, node), 0, 0);
+        } else {
+            emit(bc, OP_CMD, add_cmd(bc, node), 0, 0);
+        }
+        break;
+
+    case N_PIPE:
+        // Aşamalar ardışık komut indekslerine yerleştirilir
+        first = bc->num_cmds;
+        count = 0;
+        for (stage = node->left; stage != NULL; stage = stage->next) {
+            add_cmd(bc, stage);
+            count++;
+        }
+        emit(bc, OP_PIPE, first, count, 0);
+        break;
+
+    case N_FANOUT: {
+        // Üretici aşamaları ve ardından tüketiciler ardışık yerleştirilir
+        int num_consumers = 0;
+        first = bc->num_cmds;
+        count = 0;
+        for (stage = node->left; stage != NULL; stage = stage->next) {
+            add_cmd(bc, stage);
+            count++;
+        }
+        for (stage = node->right; stage != NULL; stage = stage->next) {
+            add_cmd(bc, stage);
+            num_consumers++;
+        }
+        emit(bc, OP_FANOUT, first, count, num_consumers);
+        break;
+    }
+
+    case N_AND:
+    case N_OR:
+        compile_node(c, node->left);
+        jump = emit(bc, node->type == N_AND ? OP_JNZ : OP_JZ, -1, 0, 0);
+        compile_node(c, node->right);
+        bc->code[jump].a = bc->code_len;
+        break;
+
+    case N_NOT:
+        compile_node(c, node->left);
+        emit(bc, OP_NOT, 0, 0, 0);
+        break;
+
+    case N_SEQ:
+        compile_node(c, node->left);
+        compile_node(c, node->right);
+        break;
+
+    case N_IF:
+        compile_node(c, node->left);
+        jump = emit(bc, OP_JNZ, -1, 0, 0);
+        compile_node(c, node->right);
+        end = emit(bc, OP_JMP, -1, 0, 0);
+        bc->code[jump].a = bc->code_len;
+        if (node->extra) {
+            compile_node(c, node->extra);
+        } else {
+            // Hiçbir dal çalışmadıysa if'in çıkış durumu 0'dır
+            emit(bc, OP_STATUS, 0, 0, 0);
+        }
+        bc->code[end].a = bc->code_len;
+        break;
+
+    case N_WHILE:
+    case N_UNTIL:
+        first = bc->code_len;
+        compile_node(c, node->left);
+        jump = emit(bc, node->type == N_WHILE ? OP_JNZ : OP_JZ, -1, 0, 0);
+        compile_loop_body(c, node->right, first, &end);
+        // Koşul başarısız olduğunda döngünün çıkış durumu 0'dır
+        bc->code[jump].a = emit(bc, OP_STATUS, 0, 0, 0);
+        break;
+
+    case N_FOR:
+        count = bc->num_slots++;
+        first = add_cmd(bc, node);
+        emit(bc, OP_FOR_INIT, first, count, 0);
+        jump = emit(bc, OP_FOR_NEXT, first, count, -1);
+        compile_loop_body(c, node->right, jump, &end);
+        bc->code[jump].c = end;
+        break;
+
+    case N_FUNC: {
+        // Gövde, tanımın hemen ardına yerleştirilir ve normal akışta atlanır
+        loop_ctx *outer = c->loop;
+        int def = emit(bc, OP_DEFUN, add_cmd(bc, node), -1, 0);
+        jump = emit(bc, OP_JMP, -1, 0, 0);
+        bc->code[def].b = bc->code_len;
+        c->loop = NULL;
+        compile_node(c, node->right);
+        c->loop = outer;
+        emit(bc, OP_RET, -1, 0, 0);
+        bc->code[jump].a = bc->code_len;
+        break;
+    }
+    }
+}
+
+/**
+ * Betik metnini bayt koduna derleyen fonksiyon.
+ * @param src Betik metni.
+ * @param out Derlenmiş bayt kodunu döndürmek için çıktı parametresi.
+ * @return COMPILE_OK, COMPILE_INCOMPLETE veya COMPILE_ERROR.
+ */
+int compile_script(const char *src, bytecode **out) {
+    int num_tokens, result;
+    bytecode *bc = calloc(1, sizeof(bytecode));
+
+    *out = NULL;
+    if (!bc || !(bc->arena = malloc(2 * strlen(src) + 1))) {
+        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+        exit(EXIT_FAILURE);
+    }
+
+    token *tokens = lex_script(src, bc->arena, &num_tokens);
+    if (tokens == NULL) {
+        release_bytecode(bc);
+        return COMPILE_INCOMPLETE;
+    }
+
+    ast_node *root = parse_script(tokens, &result);
+    free(tokens);
+    if (result != COMPILE_OK) {
+        release_bytecode(bc);
+        return result;
+    }
+
+    compiler c = { bc, NULL, 0 };
+    compile_node(&c, root);
+    emit(bc, OP_HALT, 0, 0, 0);
+    free_ast(root);
+
+    if (c.error) {
+        release_bytecode(bc);
+        return COMPILE_ERROR;
+    }
+    *out = bc;
+    return COMPILE_OK;
+}
+
+/**
+ * Bayt kodunu serbest bırakan fonksiyon. Fonksiyon tanımı içeren bayt kodu
+ * fonksiyon tablosundan referans verildiği için serbest bırakılmaz.
+ */
+void release_bytecode(bytecode *bc) {
+    if (bc == NULL || bc->retained) return;
+    for (int i = 0; i < bc->num_cmds; i++) {
+        free(bc->cmds[i].words);
+    }
+    free(bc->cmds);
+    free(bc->code);
+    free(bc->arena);
+    free(bc);
+}
+
+// ---------------------------------------------------------------------------
+// Sözcük açılımı
+// ---------------------------------------------------------------------------
+
+void str_buf_append(str_buf *buf, const char *s, int n) {
+    if (buf->len + n + 1 > buf->cap) {
+        buf->cap = (buf->len + n + 1) * 2;
+        buf->data = realloc(buf->data, buf->cap);
+        if (!buf->data) {
+            fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(buf->data + buf->len, s, n);
+    buf->len += n;
+    buf->data[buf->len] = '\0';
+}
+
+void word_list_push(word_list *list, char *item) {
+    if (list->count + 1 >= list->cap) {
+        list->cap += 16;
+        list->items = realloc(list->items, list->cap * sizeof(char*));
+        if (!list->items) {
+            fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    list->items[list->count++] = item;
+    list->items[list->count] = NULL;
+}
+
+void word_list_free(word_list *list) {
+    for (int i = 0; i < list->count; i++) {
+        free(list->items[i]);
+    }
+    free(list->items);
+    list->items = NULL;
+    list->count = list->cap = 0;
+}
+
+/**
+ * $ ile başlayan parametreyi açıp değerini tampona ekleyen fonksiyon.
+ * @return Parametreden sonraki konum; geçerli bir parametre yoksa p döner.
+ */
+const char *expand_parameter(const char *p, vm_frame *frame, str_buf *out) {
+    const char *s = p + 1;
+    char name[256];
+    char number[32];
+    int n = 0;
+
+    if (*s == '{') {
+        for (s++; *s && *s != '}'; s++) {
+            if (n < (int)sizeof(name) - 1) name[n++] = *s;
+        }
+        if (*s != '}') return p;
+        s++;
+    } else if (*s && strchr("?#$@*", *s) != NULL) {
+        name[n++] = *s++;
+    } else if (isdigit((unsigned char)*s)) {
+        name[n++] = *s++;
+    } else {
+        for (; isalnum((unsigned char)*s) || *s == '_'; s++) {
+            if (n < (int)sizeof(name) - 1) name[n++] = *s;
+        }
+    }
+    if (n == 0) return p;
+    name[n] = '\0';
+
+    if (strcmp(name, "?") == 0) {
+        snprintf(number, sizeof(number), "%d", last_status);
+        str_buf_append(out, number, strlen(number));
+    } else if (strcmp(name, "#") == 0) {
+        snprintf(number, sizeof(number), "%d", frame->argc > 0 ? frame->argc - 1 : 0);
+        str_buf_append(out, number, strlen(number));
+    } else if (strcmp(name, "$") == 0) {
+        snprintf(number, sizeof(number), "%d", (int)getpid());
+        str_buf_append(out, number, strlen(number));
+    } else if (strcmp(name, "@") == 0 || strcmp(name, "*") == 0) {
+        for (int i = 1; i < frame->argc; i++) {
+            if (i > 1) str_buf_append(out, " ", 1);
+            str_buf_append(out, frame->argv[i], strlen(frame->argv[i]));
+        }
+    } else if (isdigit((unsigned char)name[0])) {
+        int index = atoi(name);
+        if (index < frame->argc) {
+            str_buf_append(out, frame->argv[index], strlen(frame->argv[index]));
+        }
+    } else {
+        char *value = get_variable(name);
+        if (value) {
+            str_buf_append(out, value, strlen(value));
+        }
+    }
+    return s;
+}
+
+/**
+ * Ham sözcüğü açan fonksiyon: tırnakları kaldırır, değişkenleri yerine koyar ve
+ * split verilmişse tırnaksız açılımları boşluklara göre ayrı alanlara böler.
+ * @param raw Ham sözcük.
+ * @param frame Geçerli yürütme çerçevesi.
+ * @param split Alan bölme yapılsın mı (atamalarda ve yönlendirmelerde 0).
+ * @param out Üretilen alanların ekleneceği liste.
+ */
+void expand_word(const char *raw, vm_frame *frame, int split, word_list *out) {
+    str_buf field = { NULL, 0, 0 };
+    int have_field = 0;
+    const char *p = raw;
+
+    // Sözcük birimlerine ayırıcı <( ve >( ile başlayan sözcükleri yalnızca
+    // süreç yerine koyma için üretir
+    if ((raw[0] == '<' || raw[0] == '>') && raw[1] == '(') {
+        word_list_push(out, start_process_substitution(raw, frame));
+        return;
+    }
+
+    // Argüman yokken tek başına "$@" hiç alan üretmez
+    if (split && frame->argc <= 1 && (strcmp(raw, "\"$@\"") == 0 || strcmp(raw, "\"${@}\"") == 0)) {
+        return;
+    }
+
+    str_buf_append(&field, "", 0);
+    while (*p) {
+        if (*p == '\'') {
+            const char *end = strchr(p + 1, '\'');
+            if (end == NULL) end = p + strlen(p);
+            str_buf_append(&field, p + 1, end - p - 1);
+            p = *end ? end + 1 : end;
+            have_field = 1;
+        } else if (*p == '"') {
+            have_field = 1;
+            for (p++; *p && *p != '"';) {
+                if (*p == '\\' && p[1] && strchr("$\"\\`", p[1]) != NULL) {
+                    str_buf_append(&field, p + 1, 1);
+                    p += 2;
+                } else if (split && (strncmp(p, "$@", 2) == 0 || strncmp(p, "${@}", 4) == 0)) {
+                    // "$@": her konumsal parametre ayrı bir alan olur; ilki öncesindeki
+                    // metne, sonuncusu sonrasındakine eklenir
+                    p += p[1] == '{' ? 4 : 2;
+                    for (int i = 1; i < frame->argc; i++) {
+                        if (i > 1) {
+                            word_list_push(out, strdup(field.data));
+                            field.len = 0;
+                            field.data[0] = '\0';
+                        }
+                        str_buf_append(&field, frame->argv[i], strlen(frame->argv[i]));
+                    }
+                } else if (*p == '$') {
+                    const char *next = expand_parameter(p, frame, &field);
+                    if (next == p) {
+                        str_buf_append(&field, p, 1);
+                        next = p + 1;
+                    }
+                    p = next;
+                } else {
+                    str_buf_append(&field, p++, 1);
+                }
+            }
+            if (*p) p++;
+        } else if (*p == '\\') {
+            have_field = 1;
+            if (p[1]) str_buf_append(&field, p + 1, 1);
+            p += p[1] ? 2 : 1;
+        } else if (*p == '$') {
+            str_buf value = { NULL, 0, 0 };
+            const char *next = expand_parameter(p, frame, &value);
+            if (next == p) {
+                str_buf_append(&field, p++, 1);
+                have_field = 1;
+                continue;
+            }
+            p = next;
+            if (!split) {
+                if (value.len) str_buf_append(&field, value.data, value.len);
+            } else {
+                // Tırnaksız açılım boşluk karakterlerinde yeni alana geçer
+                for (int i = 0; i < value.len; i++) {
+                    char ch = value.data[i];
+                    if (ch == ' ' || ch == '\t' || ch == '\n') {
+                        if (have_field) {
+                            word_list_push(out, strdup(field.data));
+                            field.len = 0;
+                            field.data[0] = '\0';
+                            have_field = 0;
+                        }
+                    } else {
+                        str_buf_append(&field, &ch, 1);
+                        have_field = 1;
+                    }
+                }
+            }
+            free(value.data);
+        } else {
+            str_buf_append(&field, p++, 1);
+            have_field = 1;
+        }
+    }
+
+    if (have_field || !split) {
+        word_list_push(out, field.data);
+    } else {
+        free(field.data);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Süreç yerine koyma
+// ---------------------------------------------------------------------------
+
+proc_subst *procsub_list = NULL;
+int procsub_count = 0;
+int procsub_stage = -1;
+int procsub_cap = 0;
+pid_t *procsub_detached = NULL;
+int procsub_detached_count = 0;
+int procsub_detached_cap = 0;
+
+/**
+ * <(komut) veya >(komut) sözcüğünü başlatıp yerine geçecek /dev/fd/N yolunu
+ * döndüren fonksiyon. İç komut, borunun bir ucu stdout'a (<) ya da stdin'e (>)
+ * bağlanmış bir alt kabukta çalışır. Kabukta kalan uç O_CLOEXEC ile açılır;
+ * böylece yalnızca inherit_process_substitutions çağıran hedef çocukta exec
+ * sonrasına devredilir, diğer komutlara sızmaz.
+ * @return /dev/fd/N yolu (çağıran serbest bırakır).
+ */
+char *start_process_substitution(const char *raw, vm_frame *frame) {
+    int fds[2];
+    int is_output = (raw[0] == '>');
+    char path[32];
+    pid_t pid;
+
+    if (pipe2(fds, O_CLOEXEC) == -1) {
+        perror("pipe");
+        return strdup("/dev/null");
+    }
+    int parent_end = is_output ? fds[1] : fds[0];
+    int child_end = is_output ? fds[0] : fds[1];
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0) {
+        // Alt kabuk: iç komutu borunun ucuna bağlı olarak çalıştır
+        if (dup2(child_end, is_output ? STDIN_FILENO : STDOUT_FILENO) == -1) {
+            perror("dup2");
+            exit(EXIT_FAILURE);
+        }
+        close(fds[0]);
+        close(fds[1]);
+        close_process_substitutions();
+        interactive = 0;
+
+        char *inner = strndup(raw + 2, strlen(raw) - 3);
+        run_script(inner, frame->argc, frame->argv);
+        exit(last_status);
+    } else if (pid < 0) {
+        perror("fork");
+        close(fds[0]);
+        close(fds[1]);
+        return strdup("/dev/null");
+    }
+    close(child_end);
+    add_process_substitution(pid, parent_end, procsub_stage);
+
+    snprintf(path, sizeof(path), "/dev/fd/%d", parent_end);
+    return strdup(path);
+}
+
+void add_process_substitution(pid_t pid, int fd, int stage) {
+    if (procsub_count >= procsub_cap) {
+        procsub_cap += 8;
+        procsub_list = realloc(procsub_list, procsub_cap * sizeof(proc_subst));
+        if (!procsub_list) {
+            fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    proc_subst *ps = &procsub_list[procsub_count++];
+    ps->pid = pid;
+    ps->fd = fd;
+    ps->stage = stage;
+}
+
+/**
+ * Çocuk süreçte kabuktan devralınan tüm süreç yerine koyma uçlarını kapatan
+ * fonksiyon. exec yapmayan çocuklar (alt kabuk, aktarıcı) uçları tutarsa
+ * >(komut) dosya sonunu göremez.
+ */
+void close_process_substitutions() {
+    for (int i = 0; i < procsub_count; i++) {
+        if (procsub_list[i].fd >= 0) close(procsub_list[i].fd);
+    }
+    procsub_count = 0;
+}
+
+/**
+ * Çocuk süreçte exec öncesi çağrılır: komuta ait süreç yerine koyma uçlarının
+ * O_CLOEXEC bayrağını kaldırarak /dev/fd/N yollarının exec sonrası açık kalmasını
+ * sağlar. Boru hattında her aşama yalnızca kendi sözcüklerindeki uçları alır.
+ * @param stage Boru hattı aşaması; basit komutlar için -1.
+ */
+void inherit_process_substitutions(int stage) {
+    for (int i = 0; i < procsub_count; i++) {
+        proc_subst *ps = &procsub_list[i];
+        if (ps->fd >= 0 && ps->stage == stage) {
+            fcntl(ps->fd, F_SETFD, 0);
+        }
+    }
+}
+
+/**
+ * Arka plan komutlarına ait, henüz bitmemiş alt kabukları WNOHANG ile toplayan
+ * fonksiyon. Biten veya bu kabuğun çocuğu olmayan (fork ile devralınmış)
+ * kimlikler listeden çıkarılır.
+ */
+void reap_detached_substitutions() {
+    int kept = 0;
+
+    for (int i = 0; i < procsub_detached_count; i++) {
+        if (waitpid(procsub_detached[i], NULL, WNOHANG) == 0) {
+            procsub_detached[kept++] = procsub_detached[i];
+        }
+    }
+    procsub_detached_count = kept;
+}
+
+/**
+ * mark konumundan sonra başlatılan süreç yerine koymalarını sonlandıran fonksiyon.
+ * Kabuktaki boru uçları kapatılır (>(komut) bu sayede dosya sonunu görür).
+ * wait verilmişse iç komutlar beklenir; arka plan komutlarınınkiler beklenmeden
+ * procsub_detached listesine taşınır ve her çağrıda WNOHANG ile toplanır.
+ */
+void finish_process_substitutions(int mark, int wait) {
+    for (int i = mark; i < procsub_count; i++) {
+        proc_subst *ps = &procsub_list[i];
+        if (ps->fd >= 0) {
+            close(ps->fd);
+            ps->fd = -1;
+        }
+        if (wait) {
+            waitpid(ps->pid, NULL, 0);
+            continue;
+        }
+        if (procsub_detached_count >= procsub_detached_cap) {
+            procsub_detached_cap = procsub_detached_cap ? procsub_detached_cap * 2 : 8;
+            procsub_detached = realloc(procsub_detached, procsub_detached_cap * sizeof(pid_t));
+            if (!procsub_detached) {
+                fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        procsub_detached[procsub_detached_count++] = ps->pid;
+    }
+    procsub_count = mark;
+    reap_detached_substitutions();
+}
+
+// ---------------------------------------------------------------------------
+// Sanal makine
+// ---------------------------------------------------------------------------
+
+shell_function *find_function(const char *name) {
+    for (shell_function *fn = function_list; fn != NULL; fn = fn->next) {
+        if (strcmp(fn->name, name) == 0) return fn;
+    }
+    return NULL;
+}
+
+void define_function(const char *name, bytecode *bc, int entry) {
+    shell_function *fn = find_function(name);
+    if (fn == NULL) {
+        fn = malloc(sizeof(shell_function));
+        if (!fn) {
+            fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+            exit(EXIT_FAILURE);
+        }
+        fn->name = strdup(name);
+        fn->next = function_list;
+        function_list = fn;
+    }
+    fn->chunk = bc;
+    fn->entry = entry;
+    bc->retained = 1;
+}
+
+// ---------------------------------------------------------------------------
+// Kabuk değişkenleri
+// ---------------------------------------------------------------------------
+
+shell_var *variable_list = NULL;
+
+shell_var *find_variable(const char *name) {
+    for (shell_var *var = variable_list; var != NULL; var = var->next) {
+        if (strcmp(var->name, name) == 0) return var;
+    }
+    return NULL;
+}
+
+/**
+ * Değişkenin değerini döndüren fonksiyon. Ortam önce bakılır; komut önündeki
+ * geçici atamalar böylece aynı addaki kabuk değişkenini o komut boyunca örter.
+ * @return Değer veya tanımlı değilse NULL.
+ */
+char *get_variable(const char *name) {
+    char *value = getenv(name);
+    if (value != NULL) return value;
+    shell_var *var = find_variable(name);
+    return var ? var->value : NULL;
+}
+
+/**
+ * Değişkene değer atayan fonksiyon. Zaten ortamda olan (dışa aktarılmış)
+ * değişken ortamda güncellenir, diğerleri kabukta yerel kalır.
+ */
+void set_variable(const char *name, const char *value) {
+    if (getenv(name) != NULL) {
+        setenv(name, value, 1);
+        return;
+    }
+    shell_var *var = find_variable(name);
+    if (var == NULL) {
+        var = malloc(sizeof(shell_var));
+        if (!var) {
+            fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+            exit(EXIT_FAILURE);
+        }
+        var->name = strdup(name);
+        var->value = NULL;
+        var->next = variable_list;
+        variable_list = var;
+    }
+    free(var->value);
+    var->value = strdup(value);
+}
+
+void unset_local_variable(const char *name) {
+    for (shell_var **var = &variable_list; *var != NULL; var = &(*var)->next) {
+        if (strcmp((*var)->name, name) == 0) {
+            shell_var *temp = *var;
+            *var = temp->next;
+            free(temp->name);
+            free(temp->value);
+            free(temp);
+            return;
+        }
+    }
+}
+
+/**
+ * export yerleşik komutu: export AD[=değer]...
+ * Kabuk değişkenini ortama taşır; böylece sonraki tüm alt süreçlere geçer.
+ * Argümansız çağrıldığında ortamı listeler.
+ */
+int shell_export(char **args) {
+    last_status = 0;
+    if (args[1] == NULL) {
+        for (char **env = environ; *env != NULL; env++) {
+            printf("export %s\n", *env);
+        }
+        return 1;
+    }
+    for (int i = 1; args[i] != NULL; i++) {
+        char *eq = strchr(args[i], '=');
+        char *name = eq ? strndup(args[i], eq - args[i]) : strdup(args[i]);
+        const char *s = name;
+
+        while (isalnum((unsigned char)*s) || *s == '_') s++;
+        if (!isalpha((unsigned char)*name) && *name != '_') s = name;
+        if (*name == '\0' || *s != '\0') {
+            fprintf(stderr, "osprojectsh: export: '%s': geçerli bir ad değil\n", args[i]);
+            last_status = 1;
+        } else if (eq != NULL) {
+            setenv(name, eq + 1, 1);
+            unset_local_variable(name);
+        } else if (find_variable(name) != NULL) {
+            setenv(name, find_variable(name)->value, 1);
+            unset_local_variable(name);
+        }
+        free(name);
+    }
+    return 1;
+}
+
+/**
+ * Sözcüğün NAME=değer biçiminde bir atama olup olmadığını kontrol eden fonksiyon.
+ */
+int is_assignment(const char *word) {
+    const char *s = word;
+    if (!isalpha((unsigned char)*s) && *s != '_') return 0;
+    while (isalnum((unsigned char)*s) || *s == '_') s++;
+    return *s == '=';
+}
+
+/**
+ * Yönlendirme hedefi gibi tek alan üretmesi gereken sözcüğü açan fonksiyon.
+ */
+char *expand_single(const char *raw, vm_frame *frame) {
+    word_list list = { NULL, 0, 0 };
+    expand_word(raw, frame, 0, &list);
+    char *result = list.items[0];
+    free(list.items);
+    return result;
+}
+
+/**
+ * Derlenmiş basit komutu açıp çalıştıran fonksiyon. Yalnızca atama içeren komut
+ * kabuk değişkenlerini ayarlar; komutun önündeki atamalar ise yalnızca o komut
+ * çalışırken ortama yazılır. Ad bir kabuk fonksiyonuysa fonksiyon çağrılır.
+ */
+int vm_execute_cmd(compiled_cmd *cmd, vm_frame *frame) {
+    word_list args = { NULL, 0, 0 };
+    word_list assigned = { NULL, 0, 0 };    // Ad, değer çiftleri
+    word_list saved = { NULL, 0, 0 };       // Geçici atamalardan önceki ortam değerleri
+    int i, result = 1;
+    int mark = procsub_count;
+    int *deferred = NULL, num_deferred = 0;
+    int queue = 0;
+    char reason[128];
+
+    if (job_queue != NULL) {
+        admit_queued_jobs();
+    }
+    // Arka plan işinin kabulü sözcükler açılmadan önce kararlaştırılır; kuyruğa
+    // alınacak işin <(..)/>(..) alt kabukları iş kabul edilene dek başlatılmaz
+    if (cmd->background) {
+        if (job_queue != NULL) {
+            snprintf(reason, sizeof(reason), "önünde bekleyen iş var");
+            queue = 1;
+        } else {
+            queue = admission_blocked(reason, sizeof(reason));
+        }
+        if (queue && !(deferred = malloc(cmd->num_words * sizeof(int)))) {
+            fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (i = 0; i < cmd->num_words && is_assignment(cmd->words[i]); i++) {
+        char *eq = strchr(cmd->words[i], '=');
+        word_list_push(&assigned, strndup(cmd->words[i], eq - cmd->words[i]));
+        word_list_push(&assigned, expand_single(eq + 1, frame));
+    }
+    for (; i < cmd->num_words; i++) {
+        const char *raw = cmd->words[i];
+        if (queue && (raw[0] == '<' || raw[0] == '>') && raw[1] == '(') {
+            deferred[num_deferred++] = args.count;
+            word_list_push(&args, strdup(raw));
+            continue;
+        }
+        expand_word(raw, frame, 1, &args);
+    }
+
+    if (args.count == 0) {
+        // Yalnızca atama içeren komut
+        for (i = 0; i < assigned.count; i += 2) {
+            set_variable(assigned.items[i], assigned.items[i + 1]);
+        }
+        word_list_free(&assigned);
+        last_status = 0;
+        free(args.items);
+        free(deferred);
+        return 1;
+    }
+    for (i = 0; i < assigned.count; i += 2) {
+        char *old = getenv(assigned.items[i]);
+        word_list_push(&saved, old ? strdup(old) : NULL);
+        setenv(assigned.items[i], assigned.items[i + 1], 1);
+    }
+
+    char *input_file = cmd->input_file ? expand_single(cmd->input_file, frame) : NULL;
+    char *output_file = cmd->output_file ? expand_single(cmd->output_file, frame) : NULL;
+    shell_function *fn = find_function(args.items[0]);
+
+    if (queue) {
+        result = queue_background_command(args.items, deferred, num_deferred, frame, reason);
+    } else if (fn != NULL && !cmd->background && !input_file && !output_file) {
+        result = execute_bytecode(fn->chunk, fn->entry, args.count, args.items);
+    } else {
+        result = execute_simple_command(args.items, input_file, output_file, cmd->background);
+    }
+
+    finish_process_substitutions(mark, !cmd->background);
+    for (i = saved.count - 1; i >= 0; i--) {
+        if (saved.items[i]) {
+            setenv(assigned.items[2 * i], saved.items[i], 1);
+        } else {
+            unsetenv(assigned.items[2 * i]);
+        }
+    }
+    word_list_free(&saved);
+    word_list_free(&assigned);
+    free(input_file);
+    free(output_file);
+    free(deferred);
+    word_list_free(&args);
+    return result;
+}
+
+/**
+ * Boru hattı aşamalarını açıp çalıştıran fonksiyon.
+ * @param fanout_at 0 değilse ilk fanout_at aşama üretici, kalanlar fan-out tüketicisidir.
+ */
+int vm_execute_pipe(bytecode *bc, int first, int count, int fanout_at, vm_frame *frame) {
+    word_list *stages = calloc(count, sizeof(word_list));
+    char ***commands = malloc((count + 1) * sizeof(char**));
+    int *parallel = malloc(count * sizeof(int));
+    int i, j, result = 1;
+    int mark = procsub_count;
+
+    if (!stages || !commands || !parallel) {
+        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i < count; i++) {
+        compiled_cmd *cmd = &bc->cmds[first + i];
+        procsub_stage = i;
+        for (j = 0; j < cmd->num_words; j++) {
+            expand_word(cmd->words[j], frame, 1, &stages[i]);
+        }
+        commands[i] = stages[i].items;
+        parallel[i] = cmd->parallel;
+    }
+    commands[count] = NULL;
+    procsub_stage = -1;
+
+    for (i = 0; i < count; i++) {
+        if (stages[i].count == 0) {
+            fprintf(stderr, "osprojectsh: boru hattında boş komut\n");
+            last_status = 1;
+            break;
+        }
+    }
+    if (i == count && fanout_at > 0) {
+        result = execute_fanout_commands(commands, fanout_at, parallel, commands + fanout_at, count - fanout_at);
+    } else if (i == count) {
+        result = execute_piped_commands(commands, count, parallel);
+    }
+    finish_process_substitutions(mark, 1);
+
+    for (i = 0; i < count; i++) {
+        word_list_free(&stages[i]);
+    }
+    free(stages);
+    free(commands);
+    free(parallel);
+    return result;
+}
+
+/**
+ * Bayt kodu yorumlayıcı döngüsü.
+ * @return Kabuk çalışmaya devam etmeliyse 1.
+ */
+int vm_run(bytecode *bc, int pc, vm_frame *frame) {
+    while (1) {
+        instruction *in = &bc->code[pc++];
+        compiled_cmd *cmd;
+        word_list *slot;
+
+        switch (in->op) {
+        case OP_CMD:
+            if (!vm_execute_cmd(&bc->cmds[in->a], frame)) return 0;
+            break;
+        case OP_PIPE:
+            if (!vm_execute_pipe(bc, in->a, in->b, 0, frame)) return 0;
+            break;
+        case OP_FANOUT:
+            if (!vm_execute_pipe(bc, in->a, in->b + in->c, in->b, frame)) return 0;
+            break;
+        case OP_JMP:
+            pc = in->a;
+            break;
+        case OP_JZ:
+            if (last_status == 0) pc = in->a;
+            break;
+        case OP_JNZ:
+            if (last_status != 0) pc = in->a;
+            break;
+        case OP_NOT:
+            last_status = !last_status;
+            break;
+        case OP_STATUS:
+            last_status = in->a;
+            break;
+        case OP_FOR_INIT:
+            // Liste döngü başında bir kez açılır
+            cmd = &bc->cmds[in->a];
+            slot = &frame->slots[in->b];
+            word_list_free(slot);
+            for (int i = 1; i < cmd->num_words; i++) {
+                expand_word(cmd->words[i], frame, 1, slot);
+            }
+            frame->slot_pos[in->b] = 0;
+            break;
+        case OP_FOR_NEXT:
+            slot = &frame->slots[in->b];
+            if (frame->slot_pos[in->b] >= slot->count) {
+                pc = in->c;
+            } else {
+                set_variable(bc->cmds[in->a].words[0], slot->items[frame->slot_pos[in->b]++]);
+            }
+            break;
+        case OP_DEFUN:
+            define_function(bc->cmds[in->a].words[0], bc, in->b);
+            last_status = 0;
+            break;
+        case OP_RET:
+            if (in->a >= 0 && bc->cmds[in->a].words[1] != NULL) {
+                char *value = expand_single(bc->cmds[in->a].words[1], frame);
+                last_status = atoi(value) & 0xff;
+                free(value);
+            }
+            return 1;
+        case OP_HALT:
+            return 1;
+        }
+    }
+}
+
+/**
+ * Bayt kodunu yeni bir çerçevede belirtilen konumdan çalıştıran fonksiyon.
+ * @param bc Bayt kodu.
+ * @param entry Başlangıç konumu (betik için 0, fonksiyon için gövde başı).
+ * @param argc Konumsal parametre sayısı ($0 dahil).
+ * @param argv Konumsal parametreler.
+ * @return Kabuk çalışmaya devam etmeliyse 1.
+ */
+int execute_bytecode(bytecode *bc, int entry, int argc, char **argv) {
+    int mark = procsub_count;
+    vm_frame frame;
+    frame.argc = argc;
+    frame.argv = argv;
+    frame.slots = calloc(bc->num_slots + 1, sizeof(word_list));
+    frame.slot_pos = calloc(bc->num_slots + 1, sizeof(int));
+    if (!frame.slots || !frame.slot_pos) {
+        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int result = vm_run(bc, entry, &frame);
+    finish_process_substitutions(mark, 1);
+
+    for (int i = 0; i < bc->num_slots; i++) {
+        word_list_free(&frame.slots[i]);
+    }
+    free(frame.slots);
+    free(frame.slot_pos);
+    return result;
+}
+
+/**
+ * Betik metnini derleyip çalıştıran fonksiyon (-c ve betik dosyası modları).
+ * @return Kabuk çalışmaya devam etmeliyse 1.
+ */
+int run_script(const char *src, int argc, char **argv) {
+    bytecode *bc;
+    int result = compile_script(src, &bc);
+
+    if (result == COMPILE_INCOMPLETE) {
+        fprintf(stderr, "osprojectsh: sözdizimi hatası: beklenmeyen dosya sonu\n");
+    }
+    if (result != COMPILE_OK) {
+        last_status = 2;
+        return 1;
+    }
+
+    result = execute_bytecode(bc, 0, argc, argv);
+    release_bytecode(bc);
+    // Betik biterken kuyrukta kalan arka plan işleri kaybolmasın
+    drain_job_queue();
+    return result;
+}
+
+/**
+ * Komut satırını alt kabukta (fork + derleyici/sanal makine) çalıştıran fonksiyon.
+ * Çocuk, komutun çıkış durumuyla sonlanır.
+ * @return Çocuğun süreç kimliği veya hata durumunda -1.
+ */
+pid_t spawn_script(const char *command) {
+    sigset_t mask;
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Çağıran SIGCHLD'yi engellemiş olabilir; alt kabuk kendi çocuklarını bekler
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGCHLD);
+        sigprocmask(SIG_UNBLOCK, &mask, NULL);
+        close_process_substitutions();
+        interactive = 0;
+        run_script(command, 1, (char *[]){ "osprojectsh", NULL });
+        exit(last_status);
+    } else if (pid < 0) {
+        perror("fork");
+    }
+    return pid;
+}
+
+// ===========================================================================
+// run-graph: Bağımlı komut grafiği yürütücüsü
+// ===========================================================================
+
+double monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void free_graph(graph_node *nodes, int num_nodes) {
+    for (int i = 0; i < num_nodes; i++) {
+        free(nodes[i].name);
+        free(nodes[i].command);
+        free(nodes[i].deps);
+    }
+    free(nodes);
+}
+
+/**
+ * Metni UTF-8 karakter sayısına göre width sütuna hizalayarak yazdıran fonksiyon.
+ */
+void print_padded(const char *s, int width) {
+    int chars = 0;
+    for (const char *c = s; *c; c++) {
+        if ((*c & 0xC0) != 0x80) chars++;
+    }
+    printf("%s", s);
+    for (; chars < width; chars++) {
+        printf(" ");
+    }
+    printf(" ");
+}
+
+char *trim_spaces(char *s) {
+    while (*s == ' ' || *s == '\t') s++;
+    char *end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) *--end = '\0';
+    return s;
+}
+
+/**
+ * "düğüm: bağımlılıklar: komut" satırlarından oluşan grafik dosyasını okuyan
+ * fonksiyon. Bağımlılıklar boşluk veya virgülle ayrılır; '#' ile başlayan ve
+ * boş satırlar atlanır.
+ * @return Düğüm dizisi veya hata durumunda NULL.
+ */
+graph_node *load_graph(const char *path, int *num_nodes) {
+    char *source = read_file(path);
+    char *saveptr, *line;
+    graph_node *nodes = NULL;
+    int count = 0, line_no = 0, i, j;
+
+    if (source == NULL) return NULL;
+
+    // İlk geçiş: düğüm adları ve komutlar
+    char **dep_text = NULL;
+    for (line = strtok_r(source, "\n", &saveptr); line != NULL; line = strtok_r(NULL, "\n", &saveptr)) {
+        line_no++;
+        line = trim_spaces(line);
+        if (*line == '\0' || *line == '#') continue;
+
+        char *deps = strchr(line, ':');
+        char *command = deps ? strchr(deps + 1, ':') : NULL;
+        if (command == NULL) {
+            fprintf(stderr, "run-graph: %s:%d: 'düğüm: bağımlılıklar: komut' bekleniyor\n", path, line_no);
+            goto fail;
+        }
+        *deps++ = '\0';
+        *command++ = '\0';
+
+        nodes = realloc(nodes, (count + 1) * sizeof(graph_node));
+        dep_text = realloc(dep_text, (count + 1) * sizeof(char*));
+        if (!nodes || !dep_text) {
+            fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+            exit(EXIT_FAILURE);
+        }
+        memset(&nodes[count], 0, sizeof(graph_node));
+        nodes[count].name = strdup(trim_spaces(line));
+        nodes[count].command = strdup(trim_spaces(command));
+        dep_text[count] = deps;
+        for (i = 0; i < count; i++) {
+            if (strcmp(nodes[i].name, nodes[count].name) == 0) {
+                fprintf(stderr, "run-graph: %s:%d: '%s' düğümü birden fazla tanımlı\n", path, line_no, nodes[i].name);
+                count++;
+                goto fail;
+            }
+        }
+        count++;
+    }
+
+    // İkinci geçiş: bağımlılık adlarını düğüm indekslerine çevir
+    for (i = 0; i < count; i++) {
+        char *dep_save;
+        for (char *dep = strtok_r(dep_text[i], " \t,", &dep_save); dep != NULL; dep = strtok_r(NULL, " \t,", &dep_save)) {
+            for (j = 0; j < count && strcmp(nodes[j].name, dep) != 0; j++);
+            if (j == count) {
+                fprintf(stderr, "run-graph: '%s' düğümünün bağımlılığı '%s' tanımlı değil\n", nodes[i].name, dep);
+                goto fail;
+            }
+            nodes[i].deps = realloc(nodes[i].deps, (nodes[i].num_deps + 1) * sizeof(int));
+            nodes[i].deps[nodes[i].num_deps++] = j;
+        }
+    }
+
+    free(dep_text);
+    free(source);
+    *num_nodes = count;
+    return nodes;
+
+fail:
+    free(dep_text);
+    free(source);
+    free_graph(nodes, count);
+    return NULL;
+}
+
+/**
+ * Düğüm önceliklerini (kritik yol uzunluğu) hesaplayan fonksiyon. Bir düğümün
+ * önceliği, kendisinden başlayıp en uzun bağımlı zincirindeki düğüm sayısıdır.
+ * Kahn algoritmasıyla döngü de tespit edilir.
+ * @return Grafik döngüsüzse 0, döngü varsa -1.
+ */
+int compute_critical_paths(graph_node *nodes, int num_nodes) {
+    int *order = malloc(num_nodes * sizeof(int));
+    int *pending = malloc(num_nodes * sizeof(int));
+    int head = 0, tail = 0, i, j, k;
+
+    if (!order || !pending) {
+        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Topolojik sıra: bağımlılığı kalmayan düğümler sıraya girer
+    for (i = 0; i < num_nodes; i++) {
+        pending[i] = nodes[i].num_deps;
+        if (pending[i] == 0) order[tail++] = i;
+    }
+    while (head < tail) {
+        int n = order[head++];
+        for (i = 0; i < num_nodes; i++) {
+            for (j = 0; j < nodes[i].num_deps; j++) {
+                if (nodes[i].deps[j] == n && --pending[i] == 0) order[tail++] = i;
+            }
+        }
+    }
+    if (tail < num_nodes) {
+        free(order);
+        free(pending);
+        return -1;
+    }
+
+    // Ters topolojik sırada: öncelik = 1 + bağımlıların en yüksek önceliği
+    for (k = num_nodes - 1; k >= 0; k--) {
+        int n = order[k];
+        nodes[n].priority = 1;
+        for (i = 0; i < num_nodes; i++) {
+            for (j = 0; j < nodes[i].num_deps; j++) {
+                if (nodes[i].deps[j] == n && nodes[i].priority + 1 > nodes[n].priority) {
+                    nodes[n].priority = nodes[i].priority + 1;
+                }
+            }
+        }
+    }
+
+    free(order);
+    free(pending);
+    return 0;
+}
+
+/**
+ * Başarısız düğüme (doğrudan veya dolaylı) bağımlı bekleyen düğümleri atlanmış
+ * olarak işaretleyen fonksiyon.
+ */
+void skip_dependents(graph_node *nodes, int num_nodes, int failed) {
+    for (int i = 0; i < num_nodes; i++) {
+        if (nodes[i].state != GRAPH_PENDING) continue;
+        for (int j = 0; j < nodes[i].num_deps; j++) {
+            if (nodes[i].deps[j] == failed) {
+                nodes[i].state = GRAPH_SKIPPED;
+                skip_dependents(nodes, num_nodes, i);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Tüm bağımlılıkları başarıyla bitmiş, en yüksek öncelikli bekleyen düğümü
+ * bulan fonksiyon (eşitlikte dosyadaki sıra).
+ * @return Düğüm indeksi veya hazır düğüm yoksa -1.
+ */
+int next_ready_node(graph_node *nodes, int num_nodes) {
+    int best = -1;
+    for (int i = 0; i < num_nodes; i++) {
+        if (nodes[i].state != GRAPH_PENDING) continue;
+        int ready = 1;
+        for (int j = 0; j < nodes[i].num_deps && ready; j++) {
+            ready = (nodes[nodes[i].deps[j]].state == GRAPH_DONE);
+        }
+        if (ready && (best < 0 || nodes[i].priority > nodes[best].priority)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * run-graph yerleşik komutu: run-graph [-j N] dosya
+ * Grafikteki hazır düğümleri kritik yolu en uzun olandan başlayarak en fazla N
+ * (varsayılan: çekirdek sayısı) paralel alt kabukta çalıştırır. Başarısız
+ * düğümün aşağısındaki düğümler atlanır. Sonunda düğüm başına zamanlama raporu
+ * yazdırılır.
+ */
+int shell_run_graph(char **args) {
+    int max_jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    char *path = NULL;
+    int num_nodes, running = 0, failed = 0, i;
+    sigset_t block, old_mask;
+
+    for (i = 1; args[i] != NULL; i++) {
+        if (strcmp(args[i], "-j") == 0 && args[i + 1] != NULL) {
+            max_jobs = atoi(args[++i]);
+        } else {
+            path = args[i];
+        }
+    }
+    if (path == NULL || max_jobs <= 0) {
+        fprintf(stderr, "run-graph: kullanım: run-graph [-j N] dosya\n");
+        last_status = 2;
+        return 1;
+    }
+
+    graph_node *nodes = load_graph(path, &num_nodes);
+    if (nodes == NULL) {
+        last_status = 2;
+        return 1;
+    }
+    if (compute_critical_paths(nodes, num_nodes) < 0) {
+        fprintf(stderr, "run-graph: %s: grafikte döngü var\n", path);
+        free_graph(nodes, num_nodes);
+        last_status = 2;
+        return 1;
+    }
+
+    /*
+     * SIGCHLD engellenerek düğümler WNOHANG ile yoklanır, bitmiş düğüm yoksa
+     * sigsuspend ile beklenir. waitpid(-1) kullanılmadığından arka plan işleri
+     * sinyal işleyicisine kalır. Düğümler bg_list'e (owned) eklenir: jobs'ta
+     * görünür, BG_MAX_JOBS sayımına girer ve & işleri gibi kabul denetiminden
+     * geçer. Baskı yüzünden bekletilen düğüm varken bekleme 100 ms ile sınırlıdır.
+     */
+    sigemptyset(&block);
+    sigaddset(&block, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &block, &old_mask);
+    sigset_t wait_mask = old_mask;
+    sigdelset(&wait_mask, SIGCHLD);
+
+    double graph_start = monotonic_seconds();
+    struct timespec delay = { 0, 100 * 1000000L };
+    while (1) {
+        int next, held = 0;
+        while (running < max_jobs && (next = next_ready_node(nodes, num_nodes)) >= 0) {
+            // Kuyrukta bekleyen & işleri önce başlar; sınır aşılmışsa düğüm bekler
+            admit_queued_jobs();
+            if (job_queue != NULL || admission_blocked(NULL, 0)) {
+                held = 1;
+                break;
+            }
+            nodes[next].start = monotonic_seconds();
+            nodes[next].pid = spawn_script(nodes[next].command);
+            if (nodes[next].pid < 0) {
+                nodes[next].state = GRAPH_FAILED;
+                nodes[next].status = 1;
+                nodes[next].end = nodes[next].start;
+                skip_dependents(nodes, num_nodes, next);
+                failed++;
+                continue;
+            }
+            add_background_job(nodes[next].pid, strdup(nodes[next].command), 1);
+            nodes[next].state = GRAPH_RUNNING;
+            running++;
+        }
+        if (running == 0 && !held) break;
+
+        int reaped = 0;
+        for (i = 0; i < num_nodes; i++) {
+            int status;
+            if (nodes[i].state != GRAPH_RUNNING || waitpid(nodes[i].pid, &status, WNOHANG) <= 0) {
+                continue;
+            }
+            remove_background_job(nodes[i].pid);
+            nodes[i].end = monotonic_seconds();
+            nodes[i].status = exit_status_code(status);
+            nodes[i].state = nodes[i].status == 0 ? GRAPH_DONE : GRAPH_FAILED;
+            if (nodes[i].status != 0) {
+                skip_dependents(nodes, num_nodes, i);
+                failed++;
+            }
+            running--;
+            reaped++;
+        }
+        if (reaped == 0 && held) {
+            ppoll(NULL, 0, &delay, &wait_mask);
+        } else if (reaped == 0) {
+            sigsuspend(&wait_mask);
+        }
+    }
+    double graph_end = monotonic_seconds();
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+
+    // Zamanlama raporu
+    char *state_names[] = { "bekliyor", "çalışıyor", "tamam", "başarısız", "atlandı" };
+    int skipped = 0;
+    print_padded("düğüm", 20);
+    print_padded("durum", 11);
+    printf("%4s %11s %10s %8s\n", "kod", "başlangıç", "süre (sn)", "öncelik");
+    for (i = 0; i < num_nodes; i++) {
+        graph_node *n = &nodes[i];
+        print_padded(n->name, 20);
+        print_padded(state_names[n->state], 11);
+        if (n->state == GRAPH_SKIPPED) {
+            skipped++;
+            printf("%4s %10s %10s %7d\n", "-", "-", "-", n->priority);
+        } else {
+            printf("%4d %10.3f %10.3f %7d\n", n->status, n->start - graph_start, n->end - n->start, n->priority);
+        }
+    }
+    printf("toplam: %d düğüm, %d başarısız, %d atlandı, %.3f sn (en fazla %d paralel)\n",
+           num_nodes, failed, skipped, graph_end - graph_start, max_jobs);
+    fflush(stdout);
+
+    free_graph(nodes, num_nodes);
+    last_status = (failed > 0 || skipped > 0) ? 1 : 0;
+    return 1;
+}
+
+// ===========================================================================
+// Arka plan iş kabulü: & işlerini sistem baskısına göre bekleten kuyruk
+// ===========================================================================
+
+/*
+ * Sınırlar kabuk veya ortam değişkenleriyle ayarlanır; ayarlanmamış veya sıfır
+ * olan sınır denetlenmez:
+ *   BG_MAX_JOBS    Aynı anda çalışabilecek arka plan işi sayısı
+ *   BG_PSI_CPU     /proc/pressure/cpu    "some avg10" yüzdesi
+ *   BG_PSI_MEMORY  /proc/pressure/memory "some avg10" yüzdesi
+ *   BG_PSI_IO      /proc/pressure/io     "some avg10" yüzdesi
+ * avg10 son 10 saniyenin ortalaması olduğundan ani iş patlamalarına geç tepki
+ * verir; PSI sınırları BG_MAX_JOBS ile birlikte kullanılmalıdır.
+ */
+queued_job *job_queue = NULL;
+queued_job *job_queue_tail = NULL;
+pid_t job_queue_owner = 0;
+
+char *pressure_resources[] = { "cpu", "memory", "io" };
+char *pressure_limits[] = { "BG_PSI_CPU", "BG_PSI_MEMORY", "BG_PSI_IO" };
+
+/**
+ * Kuyruğu çağıran süreç adına sahiplenir. fork ile devralınan kuyruk ebeveynin
+ * işlerini içerir; alt kabuğun bunları ikinci kez başlatmaması için bırakılır.
+ */
+void own_job_queue() {
+    if (job_queue_owner != getpid()) {
+        job_queue = NULL;
+        job_queue_tail = NULL;
+        job_queue_owner = getpid();
+    }
+}
+
+void enqueue_job(queued_job *job) {
+    own_job_queue();
+    job->next = NULL;
+    if (job_queue_tail) {
+        job_queue_tail->next = job;
+    } else {
+        job_queue = job;
+    }
+    job_queue_tail = job;
+}
+
+/**
+ * Kaynağın PSI "some avg10" değerini okuyan fonksiyon.
+ * @param resource "cpu", "memory" veya "io".
+ * @return Yüzde değeri veya çekirdek PSI desteklemiyorsa -1.
+ */
+double read_pressure(const char *resource) {
+    char path[64];
+    double avg10;
+
+    snprintf(path, sizeof(path), "/proc/pressure/%s", resource);
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+    if (fscanf(f, "some avg10=%lf", &avg10) != 1) {
+        avg10 = -1;
+    }
+    fclose(f);
+    return avg10;
+}
+
+/**
+ * Çalışan arka plan işlerini sayan fonksiyon. Önce biten işler toplanır; böylece
+ * bildirimi henüz işlenmemiş zombiler ve alt kabukta devralınan, çocuğumuz
+ * olmayan kayıtlar sayılmaz.
+ */
+int count_background_jobs() {
+    int count = 0;
+    sigset_t old_mask;
+
+    block_sigchld(&old_mask);
+    reap_background_jobs();
+    for (bg_process *b = bg_list; b; b = b->next) {
+        count++;
+    }
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    return count;
+}
+
+/**
+ * Yeni bir arka plan işinin şimdi başlatılıp başlatılamayacağını belirler.
+ * @param reason Bekletme nedeninin yazılacağı tampon (NULL olabilir).
+ * @return Sınırlardan biri aşıldıysa 1, iş başlatılabilirse 0.
+ */
+int admission_blocked(char *reason, size_t size) {
+    char *value = get_variable("BG_MAX_JOBS");
+    int max_jobs = value ? atoi(value) : 0;
+
+    if (max_jobs > 0) {
+        int running = count_background_jobs();
+        if (running >= max_jobs) {
+            if (reason) snprintf(reason, size, "%d iş çalışıyor, sınır %d", running, max_jobs);
+            return 1;
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        value = get_variable(pressure_limits[i]);
+        double limit = value ? atof(value) : 0;
+        if (limit <= 0) {
+            continue;
+        }
+        double pressure = read_pressure(pressure_resources[i]);
+        if (pressure >= limit) {
+            if (reason) snprintf(reason, size, "%s baskısı %.2f >= %.2f", pressure_resources[i], pressure, limit);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Sınırlar izin verdiği sürece kuyruğun başındaki işleri başlatan fonksiyon.
+ * Komut çalıştırmadan önce, girdi beklerken ve wait/jobs/quit içinde çağrılır.
+ */
+void admit_queued_jobs() {
+    own_job_queue();
+    while (job_queue != NULL && !admission_blocked(NULL, 0)) {
+        queued_job *job = job_queue;
+        job_queue = job->next;
+        if (job_queue == NULL) {
+            job_queue_tail = NULL;
+        }
+        // Ertelenen süreç yerine koymalar, iş kuyruğa alındığındaki değişkenler
+        // ve ortamla şimdi başlatılır; uçları çocuk devralır, kabuk kapatır
+        int mark = procsub_count;
+        // Komut çalışırken kabul edilen işin çocuğu ön plandaki komutun uçlarını devralmamalı
+        for (int i = 0; i < mark; i++) {
+            if (procsub_list[i].stage == -1) procsub_list[i].stage = PROCSUB_HELD;
+        }
+        if (job->num_deferred > 0) {
+            shell_var *saved_vars = variable_list;
+            char **saved_env = environ;
+            int saved_stage = procsub_stage;
+            vm_frame frame = { job->num_params, job->params, NULL, NULL };
+
+            variable_list = job->vars;
+            environ = job->env;
+            procsub_stage = -1;
+            for (int i = 0; i < job->num_deferred; i++) {
+                char **word = &job->args[job->deferred[i]];
+                char *path = start_process_substitution(*word, &frame);
+                free(*word);
+                *word = path;
+            }
+            variable_list = saved_vars;
+            environ = saved_env;
+            procsub_stage = saved_stage;
+        }
+        start_background_job(job->args, job->env);
+        finish_process_substitutions(mark, 0);
+        for (int i = 0; i < mark; i++) {
+            if (procsub_list[i].stage == PROCSUB_HELD) procsub_list[i].stage = -1;
+        }
+
+        while (job->vars) {
+            shell_var *next = job->vars->next;
+            free(job->vars->name);
+            free(job->vars->value);
+            free(job->vars);
+            job->vars = next;
+        }
+        free_string_array(job->args);
+        free_string_array(job->env);
+        if (job->params) {
+            free_string_array(job->params);
+        }
+        free(job->deferred);
+        free(job);
+    }
+}
+
+/**
+ * Kuyruk boşalana kadar baskının düşmesini bekleyip işleri başlatan fonksiyon.
+ * Betiğin çıkış durumu ($?) korunur.
+ */
+void drain_job_queue() {
+    int saved_status = last_status;
+    struct timespec delay = { 0, 100 * 1000000L };
+
+    admit_queued_jobs();
+    while (job_queue != NULL) {
+        // Biten her arka plan işi SIGCHLD ile uykuyu erken keser
+        nanosleep(&delay, NULL);
+        admit_queued_jobs();
+    }
+    last_status = saved_status;
+}
+
+/**
+ * Argümanları boşlukla birleştiren fonksiyon (jobs çıktısı için).
+ */
+char *join_args(char **args) {
+    str_buf buf = { NULL, 0, 0 };
+
+    for (int i = 0; args[i]; i++) {
+        if (i > 0) str_buf_append(&buf, " ", 1);
+        str_buf_append(&buf, args[i], strlen(args[i]));
+    }
+    if (buf.data == NULL) {
+        return strdup("");
+    }
+    return buf.data;
+}
+
+/**
+ * jobs yerleşik komutu: çalışan ve kuyrukta bekleyen arka plan işlerini,
+ * ardından geçerli baskı değerlerini ve sınırları listeler.
+ */
+int shell_jobs(char **args) {
+    int running = 0, queued = 0;
+    char *value;
+    sigset_t old_mask;
+
+    admit_queued_jobs();
+    block_sigchld(&old_mask);
+    reap_background_jobs();
+    for (bg_process *b = bg_list; b; b = b->next) {
+        printf("[%d] çalışıyor  %s\n", b->pid, b->command);
+        running++;
+    }
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    for (queued_job *job = job_queue; job; job = job->next) {
+        char *command = join_args(job->args);
+        printf("[%d] kuyrukta   %s\n", ++queued, command);
+        free(command);
+    }
+
+    printf("çalışan: %d, kuyrukta: %d", running, queued);
+    if ((value = get_variable("BG_MAX_JOBS")) && atoi(value) > 0) {
+        printf(" (sınır %d)", atoi(value));
+    }
+    printf("\nbaskı (avg10):");
+    for (int i = 0; i < 3; i++) {
+        double pressure = read_pressure(pressure_resources[i]);
+        if (pressure < 0) {
+            printf(" %s -", pressure_resources[i]);
+        } else {
+            printf(" %s %.2f", pressure_resources[i], pressure);
+        }
+        if ((value = get_variable(pressure_limits[i])) && atof(value) > 0) {
+            printf(" (sınır %.2f)", atof(value));
+        }
+    }
+    printf("\n");
+    last_status = 0;
+    return 1;
+}
+
+/**
+ * wait yerleşik komutu: kuyruktaki tüm işler başlatılıp bütün arka plan
+ * işleri bitene kadar bekler. Süreçleri SIGCHLD işleyicisi toplar.
+ */
+int shell_wait(char **args) {
+    struct timespec delay = { 0, 100 * 1000000L };
+
+    drain_job_queue();
+    while (count_background_jobs() > 0) {
+        nanosleep(&delay, NULL);
+    }
+    last_status = 0;
+    return 1;
+}
+
+/**
+ * Dosyanın tamamını belleğe okuyan fonksiyon.
+ * @return Dosya içeriği (NUL ile sonlanır) veya hata durumunda NULL.
+ */
+char *read_file(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return NULL;
+    }
+
+    size_t len = 0, cap = 4096;
+    char *data = malloc(cap);
+    size_t n;
+    while (data && (n = fread(data + len, 1, cap - len - 1, file)) > 0) {
+        len += n;
+        if (len + 1 >= cap) {
+            cap *= 2;
+            data = realloc(data, cap);
+        }
+    }
+    fclose(file);
+    if (!data) {
+        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+        exit(EXIT_FAILURE);
+    }
+    data[len] = '\0';
+    return data;
+}
+
+int main(int argc, char **argv) {
+    char *line = NULL;
+    char *script = NULL;        // Henüz tamamlanmamış çok satırlı girdi
+    size_t script_len = 0;
+    int status = 1;
+
+    // currentDirectory için bellek ayırın
+    currentDirectory = malloc(1024 * sizeof(char));
+    if (currentDirectory == NULL) {
+        fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // -c 'komutlar' veya betik dosyası verilmişse etkileşimsiz çalış
+    if (argc > 1) {
+        interactive = 0;
+        initialize_shell();
+        if (strcmp(argv[1], "-c") == 0) {
+            if (argc < 3) {
+                fprintf(stderr, "osprojectsh: -c için argüman bekleniyor\n");
+                return 2;
+            }
+            // sh gibi: -c 'komutlar' [$0 [$1 ...]]; $0 verilmezse kabuğun adı
+            if (argc > 3) {
+                run_script(argv[2], argc - 3, argv + 3);
+            } else {
+                run_script(argv[2], 1, argv);
+            }
+        } else {
+            char *source = read_file(argv[1]);
+            if (source == NULL) {
+                return 127;
+            }
+            run_script(source, argc - 1, argv + 1);
+            free(source);
+        }
+        free(currentDirectory);
+        return last_status;
+    }
+
+    // Kabuk başlatma
+    initialize_shell();
+
+    // Ana döngü
+    do {
+        reap_detached_substitutions();
+        if (script_len == 0) {
+            display_prompt();
+        } else {
+            // Yarım kalmış if/while/for için devam satırı
+            printf("> ");
+        }
+
+        // Kuyrukta iş varken girdi beklenirken de baskı düştükçe işler başlatılır
+        struct pollfd in = { STDIN_FILENO, POLLIN, 0 };
+        while (job_queue != NULL && poll(&in, 1, 200) == 0) {
+            admit_queued_jobs();
+        }
+
+        // Kullanıcı girdisini oku
+        size_t bufsize = 0;
+        ssize_t line_len = getline(&line, &bufsize, stdin);
+        if (line_len == -1) {
+            if (feof(stdin)) {
+                // Ctrl+D ile çıkış
+                if (script_len > 0) {
+                    fprintf(stderr, "osprojectsh: sözdizimi hatası: beklenmeyen dosya sonu\n");
+                }
+                printf("\n");
+                break;
+            } else {
+                perror("osprojectsh: getline");
+                continue;
+            }
+        }
+
+        /*
+         * Satır, bekleyen girdinin sonuna eklenir ve tamamı bir kez derlenir.
+         * Yapı henüz kapanmadıysa (ör. 'done' gelmediyse) sonraki satır beklenir;
+         * döngü gövdeleri çalışırken yeniden ayrıştırılmaz.
+         */
+        script = realloc(script, script_len + line_len + 1);
+        if (!script) {
+            fprintf(stderr, "osprojectsh: Bellek tahsisi başarısız\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(script + script_len, line, line_len + 1);
+        script_len += line_len;
+
+        bytecode *bc;
+        int result = compile_script(script, &bc);
+        if (result == COMPILE_INCOMPLETE) {
+            continue;
+        }
+        script_len = 0;
+        if (result == COMPILE_ERROR) {
+            last_status = 2;
+            continue;
+        }
+
+        status = execute_bytecode(bc, 0, argc, argv);
+        release_bytecode(bc);
+
+    } while (status);
+
+    // Ctrl+D ile çıkışta kuyrukta kalan arka plan işlerini de başlat
+    drain_job_queue();
+
+    // Belleği serbest bırak
+    free(line);
+    free(script);
+    free(currentDirectory);
+
+    return EXIT_SUCCESS;
+}
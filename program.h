@@ -11,6 +11,7 @@ Bessem El Huseydi  G221210584
 #define PROGRAM_H
 
 #define _POSIX_C_SOURCE 200809L  // POSIX standartlarını etkinleştir
+#define _GNU_SOURCE              // tee(2), splice(2) ve F_SETPIPE_SZ için
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -19,6 +20,10 @@ Bessem El Huseydi  G221210584
 #include <sys/wait.h>
 #include <fcntl.h>      // Çıkış dosyası açma için eklendi
 #include <signal.h>     // Sinyal işleyici için eklendi
+#include <ctype.h>      // Değişken adı denetimi için eklendi
+#include <errno.h>      // Fan-out aktarıcısındaki hata kodları için eklendi
+#include <poll.h>       // Paralel aşama olay döngüsü için eklendi
+#include <time.h>       // run-graph zamanlama raporu için eklendi
 
 // Renk Kodları
 #define KNRM  "\x1B[0m"   // Normal
@@ -26,15 +31,25 @@ Bessem El Huseydi  G221210584
 #define KBLU  "\x1B[34m"  // Mavi
 #define KCYN  "\x1B[36m"  // Camgöbeği
 
+// Fan-out (|+) boru boyutu; aktarıcı her turda en fazla bu kadar veriyi çoğaltır
+#define FANOUT_PIPE_SIZE  (1024 * 1024)
+
+// Paralel aşama (|*N) varsayılan parça boyutu; SHARD_CHUNK ile değiştirilebilir
+#define SHARD_CHUNK_DEFAULT  (1024 * 1024)
+
 // Arka Plan Süreç Yapısı
 typedef struct bg_process {
     pid_t pid;                  // Süreç ID'si
+    char *command;              // jobs çıktısı için komut satırı
+    int owned;                  // Çağıran kendisi bekler (run-graph düğümü), SIGCHLD işleyicisi toplamaz
     struct bg_process *next;    // Sonraki süreç
 } bg_process;
 
 // Global Değişkenler
 extern char* currentDirectory;     // Geçerli Dizin
 extern bg_process *bg_list;        // Arka planda çalışan süreçler listesi
+extern int last_status;            // Son komutun çıkış durumu ($?)
+extern int interactive;            // Kabuk etkileşimli modda mı (prompt gösterilsin mi)
 
 // Yerleşik Komutlar ve Fonksiyonları
 extern char *builtin_commands[];                        // Yerleşik komutlar dizisi
@@ -55,27 +70,308 @@ void initialize_shell();
 int shell_cd(char **args);
 int shell_help(char **args);
 int shell_quit(char **args);
+int shell_true(char **args);
+int shell_false(char **args);
+int shell_run_graph(char **args);
+int shell_export(char **args);
+int shell_jobs(char **args);
+int shell_wait(char **args);
 
 // Yardımcı Fonksiyonlar
-char **split_line(char *line); // Kullanıcı girdisini tokenlara ayırır.
-char ***split_commands(char *line, int *num_commands); // Komutları borulara göre böler
 int execute_external(char **args); // Yerleşik olmayan komutları harici olarak çalıştırır.
-int execute_command(char **args, char *line); // Girilen komutu analiz eder ve uygun şekilde çalıştırır.
+void exec_command(char **args); // Çocuk süreçte komutu (fonksiyon, yerleşik veya harici) çalıştırır.
+int execute_simple_command(char **args, char *input_file, char *output_file, int background); // Ayrıştırılmış basit komutu çalıştırır.
+int exit_status_code(int status); // waitpid durumunu kabuk çıkış koduna çevirir.
+pid_t wait_foreground(pid_t pid, int *status, int options); // Beklerken kuyruktaki işleri başlatır.
 
 // Giriş ve Çıkış Yönlendirme Fonksiyonları
 int execute_external_with_input_redirection(char **args, char *input_file);
 int execute_external_with_output_redirection(char **args, char *output_file);
 
-// Arka Plan Çalıştırma Fonksiyonu
-int execute_external_background(char **args);
+// Arka Plan Çalıştırma Fonksiyonları
+int start_background_job(char **args, char **env); // Arka plan işini hemen başlatır.
+void add_background_job(pid_t pid, char *command, int owned); // Süreci arka plan listesine ekler.
+void remove_background_job(pid_t pid); // Süreci arka plan listesinden çıkarır.
+int execute_builtin_redirected(int index, char **args, char *input_file, char *output_file);
 
 // Boru (pipe) Fonksiyonları
-int execute_piped_commands(char ***commands, int num_commands);
+int execute_piped_commands(char ***commands, int num_commands, int *parallel);
+int execute_fanout_commands(char ***producer, int num_producer, int *parallel, char ***consumers, int num_consumers);
+int run_sharded_stage(char **args, int workers);
+void relay_fanout(int in_fd, int *out_fds, int num_out);
 
-// Signal Handler Fonksiyonu
+// Signal Handler Fonksiyonları
 void handle_sigchld(int sig);
+void block_sigchld(sigset_t *old_mask);
+void reap_background_jobs();
 
 // Diğer Yardımcı Fonksiyonlar
 void print_spaces();
+char *read_file(const char *path); // Betik dosyasını belleğe okur.
+
+// ---------------------------------------------------------------------------
+// Betik Derleyici ve Sanal Makine
+// Girdi bir kez sözcük birimlerine ayrılır, sözdizimi ağacına (AST) dönüştürülür
+// ve bayt koduna derlenir. Döngü gövdeleri yeniden ayrıştırılmadan çalıştırılır.
+// ---------------------------------------------------------------------------
+
+// compile_script dönüş değerleri
+#define COMPILE_OK          0
+#define COMPILE_INCOMPLETE  1   // Girdi yarım (ör. kapanmamış if/while), devam satırı gerekli
+#define COMPILE_ERROR      -1   // Sözdizimi hatası
+
+// Sözcük birimi (token) türleri
+typedef enum {
+    TK_WORD,        // Sözcük (ham metin, tırnaklar korunur)
+    TK_NEWLINE,     // Satır sonu
+    TK_SEMI,        // ;
+    TK_AMP,         // &
+    TK_AND_IF,      // &&
+    TK_OR_IF,       // ||
+    TK_PIPE,        // |
+    TK_FANOUT,      // |+
+    TK_PARALLEL,    // |*N (text: işçi sayısı, boşsa çekirdek sayısı)
+    TK_LESS,        // <
+    TK_GREAT,       // >
+    TK_LPAREN,      // (
+    TK_RPAREN,      // )
+    TK_EOF          // Girdi sonu
+} token_type;
+
+typedef struct {
+    token_type type;
+    char *text;     // TK_WORD için ham metin
+    int quoted;     // Sözcük tırnak veya kaçış karakteri içeriyor mu
+} token;
+
+// Sözdizimi ağacı düğüm türleri
+typedef enum {
+    N_SIMPLE,       // Basit komut
+    N_PIPE,         // Boru hattı (aşamalar left->next zincirinde)
+    N_FANOUT,       // Fan-out: üretici hattı left->next, tüketiciler right->next zincirinde
+    N_AND,          // left && right
+    N_OR,           // left || right
+    N_NOT,          // ! left
+    N_SEQ,          // left ; right
+    N_IF,           // if left; then right; else extra; fi
+    N_WHILE,        // while left; do right; done
+    N_UNTIL,        // until left; do right; done
+    N_FOR,          // for words[0] in words[1..]; do right; done
+    N_FUNC          // words[0]() right
+} node_type;
+
+typedef struct ast_node {
+    node_type type;
+    char **words;               // Ham sözcükler (arena belleğini gösterir)
+    int num_words;
+    char *input_file;           // '<' hedefi (ham)
+    char *output_file;          // '>' hedefi (ham)
+    int background;             // '&' ile mi çalıştırılacak
+    int parallel;               // |*N aşaması: 0 değil, -1 çekirdek sayısı kadar, N işçi
+    struct ast_node *left;      // Koşul / ilk alt düğüm
+    struct ast_node *right;     // Gövde / ikinci alt düğüm
+    struct ast_node *extra;     // else / elif dalı
+    struct ast_node *next;      // Boru hattındaki sonraki aşama
+} ast_node;
+
+// Bayt kodu işlem kodları
+typedef enum {
+    OP_CMD,         // a: komut indeksi; basit komutu çalıştır
+    OP_PIPE,        // a: ilk komut indeksi, b: aşama sayısı
+    OP_FANOUT,      // a: ilk komut indeksi, b: üretici aşama sayısı, c: tüketici sayısı
+    OP_JMP,         // a: hedef
+    OP_JZ,          // a: hedef; çıkış durumu 0 ise atla
+    OP_JNZ,         // a: hedef; çıkış durumu 0 değilse atla
+    OP_NOT,         // Çıkış durumunu tersle
+    OP_STATUS,      // a: çıkış durumunu bu değere ayarla
+    OP_FOR_INIT,    // a: komut indeksi (değişken + liste), b: döngü yuvası
+    OP_FOR_NEXT,    // a: komut indeksi, b: döngü yuvası, c: liste bitince hedef
+    OP_DEFUN,       // a: komut indeksi (fonksiyon adı), b: gövde başlangıcı
+    OP_RET,         // a: durum sözcüğünün komut indeksi veya -1
+    OP_HALT         // Yürütmeyi bitir
+} opcode;
+
+typedef struct {
+    opcode op;
+    int a, b, c;
+} instruction;
+
+// Derlenmiş basit komut
+typedef struct {
+    char **words;
+    int num_words;
+    char *input_file;
+    char *output_file;
+    int background;
+    int parallel;
+} compiled_cmd;
+
+// Derlenmiş betik
+typedef struct {
+    instruction *code;
+    int code_len, code_cap;
+    compiled_cmd *cmds;
+    int num_cmds, cmds_cap;
+    int num_slots;              // for döngüsü yuvası sayısı
+    char *arena;                // Sözcüklerin ham metni
+    int retained;               // Fonksiyon tanımı içeriyorsa serbest bırakılmaz
+} bytecode;
+
+// Açılım sonucu sözcük listesi (NULL ile sonlanır)
+typedef struct {
+    char **items;
+    int count, cap;
+} word_list;
+
+// Dinamik karakter tamponu
+typedef struct {
+    char *data;
+    int len, cap;
+} str_buf;
+
+// Yürütme çerçevesi (konumsal parametreler ve for döngüsü yuvaları)
+typedef struct {
+    int argc;
+    char **argv;
+    word_list *slots;
+    int *slot_pos;
+} vm_frame;
+
+// Kullanıcı tanımlı fonksiyon
+typedef struct shell_function {
+    char *name;
+    bytecode *chunk;
+    int entry;
+    struct shell_function *next;
+} shell_function;
+
+extern shell_function *function_list;   // Tanımlı fonksiyonlar
+shell_function *find_function(const char *name);
+
+// Kabuk değişkeni. Atamalar ve for değişkenleri bu tabloda tutulur; alt süreçlerin
+// ortamına yalnızca export edilmiş değişkenler ve komutun önündeki NAME=değer
+// atamaları (yalnızca o komut için) geçer.
+typedef struct shell_var {
+    char *name;
+    char *value;
+    struct shell_var *next;
+} shell_var;
+
+extern shell_var *variable_list;        // Dışa aktarılmamış kabuk değişkenleri
+
+// Sözcük birimlerine ayırma ve ayrıştırma
+token *lex_script(const char *src, char *arena, int *num_tokens);
+ast_node *parse_script(token *tokens, int *result);
+void free_ast(ast_node *node);
+
+// Derleme ve yürütme
+int compile_script(const char *src, bytecode **out);
+void release_bytecode(bytecode *bc);
+int execute_bytecode(bytecode *bc, int entry, int argc, char **argv);
+int run_script(const char *src, int argc, char **argv);
+pid_t spawn_script(const char *command);
+
+// Kabuk değişkenleri
+char *get_variable(const char *name);
+void set_variable(const char *name, const char *value);
+void unset_local_variable(const char *name);
+
+// Sözcük açılımı (tırnak kaldırma, değişkenler, alan bölme)
+void expand_word(const char *raw, vm_frame *frame, int split, word_list *out);
+void word_list_push(word_list *list, char *item);
+void word_list_free(word_list *list);
+void str_buf_append(str_buf *buf, const char *s, int n);
+
+// Süreç Yerine Koyma (<(komut) ve >(komut))
+typedef struct {
+    pid_t pid;          // İç komutu çalıştıran alt kabuk
+    int fd;             // Kabukta kalan boru ucu (/dev/fd/N), kapatıldıysa -1
+    int stage;          // Ait olduğu boru hattı aşaması, basit komut için -1
+} proc_subst;
+
+#define PROCSUB_HELD  -2   // Geçici olarak hiçbir çocuğa devredilmeyen uç
+
+extern proc_subst *procsub_list;   // Etkin süreç yerine koymaları
+extern int procsub_count;
+extern int procsub_stage;          // Açılımı yapılan boru hattı aşaması
+extern pid_t *procsub_detached;    // Arka plan komutlarının toplanmayı bekleyen alt kabukları
+extern int procsub_detached_count;
+
+char *start_process_substitution(const char *raw, vm_frame *frame);
+void inherit_process_substitutions(int stage);
+void add_process_substitution(pid_t pid, int fd, int stage);
+void close_process_substitutions();
+void finish_process_substitutions(int mark, int wait);
+void reap_detached_substitutions();
+
+// Paralel Boru Aşaması (|*N): bir parçayı işleyen filtre kopyası
+typedef struct {
+    pid_t pid;
+    int in_fd;          // Parçanın yazıldığı boru, tamamı yazıldıysa -1
+    int out_fd;         // Çıktının okunduğu boru, dosya sonunda -1
+    char *input;        // Parça verisi
+    size_t input_len, input_off;
+    str_buf output;     // Sırası gelene kadar bekletilen çıktı
+} shard_job;
+
+int write_all(int fd, const char *data, size_t len);
+size_t next_chunk_length(str_buf *pending, size_t chunk_size, char delim, int input_eof);
+void start_shard_job(shard_job *job, char **args, const char *data, size_t len);
+
+// run-graph: Bağımlı Komut Grafiği
+typedef enum {
+    GRAPH_PENDING,      // Bağımlılıkları bekleniyor
+    GRAPH_RUNNING,      // Çalışıyor
+    GRAPH_DONE,         // Başarıyla bitti
+    GRAPH_FAILED,       // Sıfırdan farklı çıkış durumu
+    GRAPH_SKIPPED       // Bir bağımlılığı başarısız olduğu için atlandı
+} graph_state;
+
+typedef struct {
+    char *name;
+    char *command;
+    int *deps;          // Bağımlı olunan düğümlerin indeksleri
+    int num_deps;
+    graph_state state;
+    int priority;       // Kritik yol uzunluğu (düğüm sayısı)
+    pid_t pid;
+    int status;
+    double start, end;  // Monoton saat (sn)
+} graph_node;
+
+graph_node *load_graph(const char *path, int *num_nodes);
+int compute_critical_paths(graph_node *nodes, int num_nodes);
+void skip_dependents(graph_node *nodes, int num_nodes, int failed);
+int next_ready_node(graph_node *nodes, int num_nodes);
+void free_graph(graph_node *nodes, int num_nodes);
+double monotonic_seconds();
+char *trim_spaces(char *s);
+void print_padded(const char *s, int width);
+
+// Arka Plan İş Kabulü: sistem baskısı yüksekken & işlerini bekleten kuyruk
+typedef struct queued_job {
+    char **args;                // Kopyalanmış komut argümanları
+    char **env;                 // Kuyruğa alındığı andaki ortam (komut önü atamalar dahil)
+    int *deferred;              // Açılmamış <(..)/>(..) sözcüklerinin args içindeki indisleri
+    int num_deferred;
+    shell_var *vars;            // Ertelenen açılımlar için kuyruğa alındığı andaki kabuk değişkenleri
+    char **params;              // ve konumsal parametreler
+    int num_params;
+    struct queued_job *next;
+} queued_job;
+
+extern queued_job *job_queue;      // Başlatılmayı bekleyen arka plan işleri (FIFO)
+
+void own_job_queue();
+void enqueue_job(queued_job *job);
+int admission_blocked(char *reason, size_t size);
+void admit_queued_jobs();
+void drain_job_queue();
+double read_pressure(const char *resource);
+int count_background_jobs();
+char *join_args(char **args);
+char **copy_string_array(char **items, int count);
+void free_string_array(char **items);
+int queue_background_command(char **args, int *deferred, int num_deferred, vm_frame *frame, const char *reason);
 
 #endif // PROGRAM_H